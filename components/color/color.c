@@ -1011,6 +1011,40 @@ void blur1d(rgb_t *leds, size_t num_leds, fract8 blur_amount)
     }
 }
 
+static inline void blur_pixel(rgb_t *leds, size_t offs, size_t prev_offs, bool first,
+                              uint8_t keep, uint8_t seep, rgb_t *carryover)
+{
+    rgb_t cur = leds[offs];
+    rgb_t part = rgb_scale(cur, seep);
+    cur = rgb_add_rgb(rgb_scale(cur, keep), *carryover);
+    if (!first)
+        leds[prev_offs] = rgb_add_rgb(leds[prev_offs], part);
+    leds[offs] = cur;
+    *carryover = part;
+}
+
+// blur line of pixels with constant stride
+static void blur_line(rgb_t *leds, size_t count, size_t stride, uint8_t keep, uint8_t seep)
+{
+    rgb_t carryover = rgb_from_code(0);
+    size_t offs = 0;
+    for (size_t i = 0; i < count; i++, offs += stride)
+        blur_pixel(leds, offs, offs - stride, i == 0, keep, seep, &carryover);
+}
+
+// blur line of pixels addressed by lookup table with constant stride
+static void blur_line_lut(rgb_t *leds, const uint16_t *lut, size_t count, size_t stride, uint8_t keep, uint8_t seep)
+{
+    rgb_t carryover = rgb_from_code(0);
+    size_t prev_offs = 0;
+    for (size_t i = 0; i < count; i++, lut += stride)
+    {
+        size_t offs = *lut;
+        blur_pixel(leds, offs, prev_offs, i == 0, keep, seep, &carryover);
+        prev_offs = offs;
+    }
+}
+
 void blur_columns(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, xy_to_offs_cb xy, void *ctx)
 {
     // blur columns
@@ -1019,20 +1053,12 @@ void blur_columns(rgb_t *leds, size_t width, size_t height, fract8 blur_amount,
     for (size_t col = 0; col < width; ++col)
     {
         rgb_t carryover = rgb_from_code(0);
+        size_t prev_offs = 0;
         for (size_t i = 0; i < height; ++i)
         {
             size_t offs = xy(ctx, col, i);
-            rgb_t cur = leds[offs];
-            rgb_t part = cur;
-            part = rgb_scale(part, seep);
-            cur = rgb_add_rgb(rgb_scale(cur, keep), carryover);
-            if (i)
-            {
-                size_t prev_offs = xy(ctx, col, i - 1);
-                leds[prev_offs] = rgb_add_rgb(leds[prev_offs], part);
-            }
-            leds[offs] = cur;
-            carryover = part;
+            blur_pixel(leds, offs, prev_offs, i == 0, keep, seep, &carryover);
+            prev_offs = offs;
         }
     }
 }
@@ -1045,20 +1071,12 @@ void blur_rows(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, xy_
     for (size_t row = 0; row < height; row++)
     {
         rgb_t carryover = rgb_from_code(0);
+        size_t prev_offs = 0;
         for (size_t i = 0; i < width; i++)
         {
             size_t offs = xy(ctx, i, row);
-            rgb_t cur = leds[offs];
-            rgb_t part = cur;
-            part = rgb_scale(part, seep);
-            cur = rgb_add_rgb(rgb_scale(cur, keep), carryover);
-            if (i)
-            {
-                size_t prev_offs = xy(ctx, i - 1, row);
-                leds[prev_offs] = rgb_add_rgb(leds[prev_offs], part);
-            }
-            leds[offs] = cur;
-            carryover = part;
+            blur_pixel(leds, offs, prev_offs, i == 0, keep, seep, &carryover);
+            prev_offs = offs;
         }
     }
 }
@@ -1069,6 +1087,70 @@ void blur2d(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, xy_to_
     blur_columns(leds, width, height, blur_amount, xy, ctx);
 }
 
+void blur2d_layout(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, matrix_layout_t layout)
+{
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+
+    // blur is symmetric, so reversed rows of serpentine matrix are blurred the same way
+    for (size_t row = 0; row < height; row++)
+        blur_line(leds + row * width, width, 1, keep, seep);
+
+    if (layout == MATRIX_LAYOUT_ROWS)
+    {
+        for (size_t col = 0; col < width; col++)
+            blur_line(leds + col, height, width, keep, seep);
+        return;
+    }
+
+    // serpentine: odd rows are mirrored, so the column alternates between two offsets in a row
+    for (size_t col = 0; col < width; col++)
+    {
+        rgb_t carryover = rgb_from_code(0);
+        size_t even = col;
+        size_t odd = 2 * width - 1 - col;
+        size_t prev_offs = 0;
+        for (size_t i = 0; i < height; i++)
+        {
+            size_t offs = (i & 1) ? odd : even;
+            blur_pixel(leds, offs, prev_offs, i == 0, keep, seep, &carryover);
+            prev_offs = offs;
+            if (i & 1)
+            {
+                even += 2 * width;
+                odd += 2 * width;
+            }
+        }
+    }
+}
+
+uint16_t *xy_lut_create(size_t width, size_t height, xy_to_offs_cb xy, void *ctx)
+{
+    if (!width || !height || !xy || width * height > UINT16_MAX + 1)
+        return NULL;
+
+    uint16_t *lut = malloc(width * height * sizeof(uint16_t));
+    if (!lut)
+        return NULL;
+
+    for (size_t y = 0; y < height; y++)
+        for (size_t x = 0; x < width; x++)
+            lut[y * width + x] = xy(ctx, x, y);
+
+    return lut;
+}
+
+void blur2d_lut(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, const uint16_t *lut)
+{
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+
+    for (size_t row = 0; row < height; row++)
+        blur_line_lut(leds, lut + row * width, width, 1, keep, seep);
+    for (size_t col = 0; col < width; col++)
+        blur_line_lut(leds, lut + col, height, width, keep, seep);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 uint8_t apply_gamma2brightness(uint8_t brightness, float gamma)
@@ -1100,3 +1182,157 @@ rgb_t apply_gamma2rgb_channels(rgb_t c, float gamma_r, float gamma_g, float gamm
     };
     return res;
 }
+
+void gamma_lut_init(uint8_t lut[256], float gamma)
+{
+    for (size_t i = 0; i < 256; i++)
+        lut[i] = apply_gamma2brightness(i, gamma);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void color_correction_set(color_correction_t *cc, rgb_t balance, uint8_t brightness)
+{
+    cc->balance = balance;
+    cc->brightness = brightness;
+
+    uint32_t bri = (uint32_t)brightness + 1;
+    uint32_t scale[3] = {
+        ((uint32_t)balance.r + 1) * bri,
+        ((uint32_t)balance.g + 1) * bri,
+        ((uint32_t)balance.b + 1) * bri,
+    };
+    for (size_t c = 0; c < 3; c++)
+        for (size_t i = 0; i < 256; i++)
+            cc->lut[c][i] = (cc->gamma[i] * scale[c]) >> 16;
+}
+
+void color_correction_init(color_correction_t *cc, float gamma, rgb_t balance, uint8_t brightness, bool dither)
+{
+    cc->dither = dither;
+    for (size_t i = 0; i < 256; i++)
+        cc->gamma[i] = (uint16_t)(powf(i / 255.0f, gamma) * 255.0f * 256.0f);
+    color_correction_set(cc, balance, brightness);
+}
+
+void color_correction_apply(const color_correction_t *cc, rgb_t *dst, const rgb_t *src, size_t num, uint8_t frame)
+{
+    for (size_t i = 0; i < num; i++)
+    {
+        uint8_t d = color_correction_dither(cc, frame, i);
+        rgb_t c = src[i];
+        dst[i].r = color_correction_channel(cc, 0, c.r, d);
+        dst[i].g = color_correction_channel(cc, 1, c.g, d);
+        dst[i].b = color_correction_channel(cc, 2, c.b, d);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// rgb_t arrays are processed as plain byte arrays, four channels per word:
+// every byte lane of a 32-bit word is handled by 16-bit lanes of even and
+// odd bytes, wide enough to hold intermediate products without carries
+// between lanes.
+
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+#define LANES_EVEN 0x00ff00ffu
+#define LANES_MSB  0x80808080u
+
+static inline uint32_t swar_scale(uint32_t w, uint32_t scale_fixed)
+{
+    return (((w & LANES_EVEN) * scale_fixed >> 8) & LANES_EVEN)
+           | (((w >> 8) & LANES_EVEN) * scale_fixed & ~LANES_EVEN);
+}
+
+static inline uint32_t swar_qadd(uint32_t a, uint32_t b)
+{
+    uint32_t sum = ((a & ~LANES_MSB) + (b & ~LANES_MSB)) ^ ((a ^ b) & LANES_MSB);
+    uint32_t carry = ((a & b) | ((a | b) & ~sum)) & LANES_MSB;
+    return sum | ((carry >> 7) * 0xff);
+}
+
+// blend8(a, b, f) = (a * (256 - f) + b * (f + 1)) >> 8, never exceeds 16 bits
+static inline uint32_t swar_blend(uint32_t a, uint32_t b, uint32_t amount_a, uint32_t amount_b)
+{
+    return ((((a & LANES_EVEN) * amount_a + (b & LANES_EVEN) * amount_b) >> 8) & LANES_EVEN)
+           | ((((a >> 8) & LANES_EVEN) * amount_a + ((b >> 8) & LANES_EVEN) * amount_b) & ~LANES_EVEN);
+}
+
+// number of leading bytes to process one by one to get aligned words
+static inline size_t align_head(const void *p, size_t len)
+{
+    size_t head = (-(uintptr_t)p) & 3;
+    return head < len ? head : len;
+}
+
+void rgb_bulk_scale(rgb_t *leds, size_t num, uint8_t scaledown)
+{
+    uint8_t *p = (uint8_t *)leds;
+    size_t len = num * sizeof(rgb_t);
+    uint32_t scale_fixed = (uint32_t)scaledown + 1;
+
+    for (size_t head = align_head(p, len); head; head--, len--, p++)
+        *p = scale8(*p, scaledown);
+    for (; len >= 4; len -= 4, p += 4)
+        *(word_t *)p = swar_scale(*(word_t *)p, scale_fixed);
+    for (; len; len--, p++)
+        *p = scale8(*p, scaledown);
+}
+
+void rgb_bulk_fade(rgb_t *leds, size_t num, uint8_t fade_factor)
+{
+    rgb_bulk_scale(leds, num, ~fade_factor);
+}
+
+void rgb_bulk_add(rgb_t *dst, const rgb_t *src, size_t num)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    size_t len = num * sizeof(rgb_t);
+
+    // word access is possible only when both arrays can be aligned at once
+    size_t head = ((uintptr_t)d & 3) == ((uintptr_t)s & 3) ? align_head(d, len) : len;
+    for (; head; head--, len--, d++, s++)
+        *d = qadd8(*d, *s);
+    for (; len >= 4; len -= 4, d += 4, s += 4)
+        *(word_t *)d = swar_qadd(*(word_t *)d, *(const word_t *)s);
+    for (; len; len--, d++, s++)
+        *d = qadd8(*d, *s);
+}
+
+void rgb_bulk_blend(rgb_t *dst, const rgb_t *src, size_t num, fract8 amount)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    size_t len = num * sizeof(rgb_t);
+    uint32_t amount_a = 256 - (uint32_t)amount;
+    uint32_t amount_b = (uint32_t)amount + 1;
+
+    size_t head = ((uintptr_t)d & 3) == ((uintptr_t)s & 3) ? align_head(d, len) : len;
+    for (; head; head--, len--, d++, s++)
+        *d = blend8(*d, *s, amount);
+    for (; len >= 4; len -= 4, d += 4, s += 4)
+        *(word_t *)d = swar_blend(*(word_t *)d, *(const word_t *)s, amount_a, amount_b);
+    for (; len; len--, d++, s++)
+        *d = blend8(*d, *s, amount);
+}
+
+void rgb_bulk_gamma(rgb_t *leds, size_t num, const uint8_t lut[256])
+{
+    uint8_t *p = (uint8_t *)leds;
+    size_t len = num * sizeof(rgb_t);
+
+    for (size_t head = align_head(p, len); head; head--, len--, p++)
+        *p = lut[*p];
+    for (; len >= 4; len -= 4, p += 4)
+    {
+        uint32_t w = *(word_t *)p;
+        *(word_t *)p = lut[w & 0xff]
+                       | (uint32_t)lut[(w >> 8) & 0xff] << 8
+                       | (uint32_t)lut[(w >> 16) & 0xff] << 16
+                       | (uint32_t)lut[w >> 24] << 24;
+    }
+    for (; len; len--, p++)
+        *p = lut[*p];
+}
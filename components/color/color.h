@@ -290,6 +290,14 @@ rgb_t color_from_palette_rgb(const rgb_t *palette, uint8_t pal_size, uint8_t ind
  */
 typedef size_t (*xy_to_offs_cb)(void *ctx, size_t x, size_t y);
 
+/**
+ * Common matrix layouts with fast paths in filter functions
+ */
+typedef enum {
+    MATRIX_LAYOUT_ROWS = 0,   ///< Row-major, offset = y * width + x
+    MATRIX_LAYOUT_SERPENTINE, ///< Row-major with every odd row reversed
+} matrix_layout_t;
+
 /**
  * @brief One-dimensional blur filter.
  *
@@ -336,6 +344,32 @@ void blur_rows(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, xy_
  */
 void blur2d(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, xy_to_offs_cb xy, void *ctx);
 
+/**
+ * @brief Two-dimensional blur filter for matrix with common layout
+ *
+ * Same as ::blur2d() but pixel offsets are computed inline instead of
+ * calling mapping function for every pixel.
+ */
+void blur2d_layout(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, matrix_layout_t layout);
+
+/**
+ * @brief Create lookup table of pixel offsets for arbitrary matrix layout
+ *
+ * Table has `width * height` entries, entry `y * width + x` is the offset
+ * of pixel (x, y). Free it with `free()`.
+ *
+ * @return Lookup table or NULL if out of memory or matrix has more than 65536 pixels
+ */
+uint16_t *xy_lut_create(size_t width, size_t height, xy_to_offs_cb xy, void *ctx);
+
+/**
+ * @brief Two-dimensional blur filter for matrix with lookup table layout
+ *
+ * Same as ::blur2d() but pixel offsets are taken from the table created
+ * by ::xy_lut_create().
+ */
+void blur2d_lut(rgb_t *leds, size_t width, size_t height, fract8 blur_amount, const uint16_t *lut);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Gamma functions
 
@@ -357,6 +391,129 @@ rgb_t apply_gamma2rgb(rgb_t c, float gamma);
  */
 rgb_t apply_gamma2rgb_channels(rgb_t c, float gamma_r, float gamma_g, float gamma_b);
 
+/**
+ * @brief Fill gamma lookup table for use in ::rgb_bulk_gamma()
+ *
+ * `lut[i] = apply_gamma2brightness(i, gamma)`
+ */
+void gamma_lut_init(uint8_t lut[256], float gamma);
+
+////////////////////////////////////////////////////////////////////////////////
+// Color correction
+
+/**
+ * Color correction tables: gamma, white balance and global brightness
+ * baked into 8.8 fixed point lookup tables, one per channel.
+ */
+typedef struct
+{
+    uint16_t gamma[256];       ///< Gamma curve, 8.8 fixed point
+    uint16_t lut[3][256];      ///< Final R, G, B tables, 8.8 fixed point
+    rgb_t balance;             ///< White balance, channel scale factors
+    uint8_t brightness;        ///< Global brightness
+    bool dither;               ///< Temporal dithering of the fractional part
+} color_correction_t;
+
+/**
+ * @brief Build color correction tables
+ *
+ * @param cc            Color correction descriptor
+ * @param gamma         Gamma, 1.0 for linear output
+ * @param balance       White balance, {255, 255, 255} for none
+ * @param brightness    Global brightness
+ * @param dither        Enable temporal dithering. Fractional part of the
+ *                      corrected value is spread over 8 successive frames
+ */
+void color_correction_init(color_correction_t *cc, float gamma, rgb_t balance, uint8_t brightness, bool dither);
+
+/**
+ * @brief Change white balance and brightness without recalculating gamma curve
+ */
+void color_correction_set(color_correction_t *cc, rgb_t balance, uint8_t brightness);
+
+/**
+ * Dithering offset for ::color_correction_channel() that rounds corrected
+ * value to nearest
+ */
+#define COLOR_CORRECTION_NO_DITHER 0x80
+
+/**
+ * @brief Get dithering offset for pixel
+ *
+ * @param cc        Color correction descriptor
+ * @param frame     Frame counter, incremented by the caller on each output frame
+ * @param pixel     Pixel index, shifts the dithering phase of neighbour pixels
+ * @return          Offset to pass to ::color_correction_channel()
+ */
+LIB8STATIC_ALWAYS_INLINE uint8_t color_correction_dither(const color_correction_t *cc, uint8_t frame, size_t pixel)
+{
+    // bit-reversed 3-bit phase, no table so it may be used from ISR
+    uint8_t phase = (frame + pixel) & 7;
+    phase = ((phase & 1) << 2) | (phase & 2) | (phase >> 2);
+    return cc->dither ? (phase << 5) | 0x10 : COLOR_CORRECTION_NO_DITHER;
+}
+
+/**
+ * @brief Correct single channel value
+ *
+ * @param cc        Color correction descriptor
+ * @param channel   Channel: 0 - red, 1 - green, 2 - blue
+ * @param value     Channel value
+ * @param dither    Offset from ::color_correction_dither() or
+ *                  ::COLOR_CORRECTION_NO_DITHER
+ * @return          Corrected value
+ */
+LIB8STATIC_ALWAYS_INLINE uint8_t color_correction_channel(const color_correction_t *cc, uint8_t channel, uint8_t value, uint8_t dither)
+{
+    return (cc->lut[channel][value] + dither) >> 8;
+}
+
+/**
+ * @brief Correct array of colors
+ *
+ * @param cc        Color correction descriptor
+ * @param dst       Corrected colors, may be the same as \p src
+ * @param src       Source colors
+ * @param num       Number of colors
+ * @param frame     Frame counter for temporal dithering
+ */
+void color_correction_apply(const color_correction_t *cc, rgb_t *dst, const rgb_t *src, size_t num, uint8_t frame);
+
+////////////////////////////////////////////////////////////////////////////////
+// Bulk array functions
+//
+// These functions are equivalent to the loops over per-pixel functions, but
+// process four channels at once in a 32-bit word. Results are bit-exact.
+
+/**
+ * @brief ::rgb_scale() for each color in array
+ */
+void rgb_bulk_scale(rgb_t *leds, size_t num, uint8_t scaledown);
+
+/**
+ * @brief ::rgb_fade() for each color in array
+ */
+void rgb_bulk_fade(rgb_t *leds, size_t num, uint8_t fade_factor);
+
+/**
+ * @brief ::rgb_add_rgb() for each pair of colors, `dst[i] = dst[i] + src[i]`
+ */
+void rgb_bulk_add(rgb_t *dst, const rgb_t *src, size_t num);
+
+/**
+ * @brief ::rgb_blend() for each pair of colors, `dst[i] = blend(dst[i], src[i], amount)`
+ */
+void rgb_bulk_blend(rgb_t *dst, const rgb_t *src, size_t num, fract8 amount);
+
+/**
+ * @brief Apply gamma lookup table to each channel of each color in array
+ *
+ * @param leds  Colors
+ * @param num   Number of colors
+ * @param lut   Table filled by ::gamma_lut_init()
+ */
+void rgb_bulk_gamma(rgb_t *leds, size_t num, const uint8_t lut[256]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,6 +39,7 @@
 #include <string.h>
 #include <freertos/semphr.h>
 #include <esp_timer.h>
+#include <math.h>
 
 #define MUTEX_TIMEOUT 10
 
@@ -52,6 +53,15 @@
 #error Too small CONFIG_RE_INTERVAL_US! For ESP8266 it should be >= 10000
 #endif
 
+#ifdef CONFIG_IDF_TARGET_ESP8266
+#define PORT_ENTER_CRITICAL() portENTER_CRITICAL()
+#define PORT_EXIT_CRITICAL()  portEXIT_CRITICAL()
+#else
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#define PORT_ENTER_CRITICAL() portENTER_CRITICAL_SAFE(&mux)
+#define PORT_EXIT_CRITICAL()  portEXIT_CRITICAL_SAFE(&mux)
+#endif
+
 static const char *TAG = "encoder";
 static rotary_encoder_t *encs[CONFIG_RE_MAX] = { 0 };
 static const int8_t valid_states[] = { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
@@ -62,6 +72,139 @@ static QueueHandle_t _queue;
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 
+static int32_t IRAM_ATTR make_step(rotary_encoder_t *re, int8_t inc)
+{
+    int64_t nowMicros = esp_timer_get_time();
+
+    PORT_ENTER_CRITICAL();
+    re->motion.time[re->motion.pos] = nowMicros;
+    re->motion.dir[re->motion.pos] = inc;
+    re->motion.pos = (re->motion.pos + 1) % RE_MOTION_HISTORY;
+    if (re->motion.len < RE_MOTION_HISTORY)
+        re->motion.len++;
+    PORT_EXIT_CRITICAL();
+
+    if (re->acceleration.coeff <= 1)
+        return inc;
+
+    // at 200 ms, we want to have minimum acceleration
+    uint32_t accelerationMinCutoffMillis = CONFIG_RE_ACCELERATION_MIN_CUTOFF;
+    // at 4 ms, we want to have maximum acceleration
+    uint32_t accelerationMaxCutoffMillis = CONFIG_RE_ACCELERATION_MAX_CUTOFF;
+    uint32_t millisAfterLastMotion = (nowMicros - re->acceleration.last_time) / 1000u;
+    re->acceleration.last_time = nowMicros;
+
+    if (millisAfterLastMotion >= accelerationMinCutoffMillis)
+        return inc;
+
+    if (millisAfterLastMotion < accelerationMaxCutoffMillis)
+    {
+        millisAfterLastMotion = accelerationMaxCutoffMillis; // limit to maximum acceleration
+    }
+    return inc * ((int32_t)(re->acceleration.coeff / millisAfterLastMotion) == 0 ? 1 : (int32_t)(re->acceleration.coeff / millisAfterLastMotion));
+}
+
+#if CONFIG_RE_USE_PCNT
+
+static bool IRAM_ATTR pcnt_reach_callback(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t *edata, void *arg)
+{
+    rotary_encoder_t *re = (rotary_encoder_t *)arg;
+
+    // counter is cleared by hardware on reaching the limits, so every event is exactly one step
+    rotary_encoder_event_t ev = {
+        .type = RE_ET_CHANGED,
+        .sender = re,
+        .diff = make_step(re, edata->watch_point_value > 0 ? 1 : -1),
+    };
+
+    BaseType_t woken = pdFALSE;
+    xQueueSendToBackFromISR(_queue, &ev, &woken);
+    return woken == pdTRUE;
+}
+
+#define CHECK_GOTO(x) do { if ((res = (x)) != ESP_OK) goto fail; } while (0)
+
+static esp_err_t pcnt_init(rotary_encoder_t *re)
+{
+    esp_err_t res;
+    bool enabled = false;
+
+    re->pcnt_chan_a = NULL;
+    re->pcnt_chan_b = NULL;
+
+    pcnt_unit_config_t unit_config = {
+        .high_limit = CONFIG_RE_PCNT_COUNTS_PER_STEP,
+        .low_limit = -CONFIG_RE_PCNT_COUNTS_PER_STEP,
+    };
+    CHECK(pcnt_new_unit(&unit_config, &re->pcnt_unit));
+
+#if CONFIG_RE_PCNT_GLITCH_NS > 0
+    pcnt_glitch_filter_config_t filter_config = {
+        .max_glitch_ns = CONFIG_RE_PCNT_GLITCH_NS,
+    };
+    CHECK_GOTO(pcnt_unit_set_glitch_filter(re->pcnt_unit, &filter_config));
+#endif
+
+    // x4 quadrature decoding, direction matches software decoder
+    pcnt_chan_config_t chan_a_config = {
+        .edge_gpio_num = re->pin_a,
+        .level_gpio_num = re->pin_b,
+    };
+    CHECK_GOTO(pcnt_new_channel(re->pcnt_unit, &chan_a_config, &re->pcnt_chan_a));
+    pcnt_chan_config_t chan_b_config = {
+        .edge_gpio_num = re->pin_b,
+        .level_gpio_num = re->pin_a,
+    };
+    CHECK_GOTO(pcnt_new_channel(re->pcnt_unit, &chan_b_config, &re->pcnt_chan_b));
+    CHECK_GOTO(pcnt_channel_set_edge_action(re->pcnt_chan_a, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE));
+    CHECK_GOTO(pcnt_channel_set_level_action(re->pcnt_chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+    CHECK_GOTO(pcnt_channel_set_edge_action(re->pcnt_chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE));
+    CHECK_GOTO(pcnt_channel_set_level_action(re->pcnt_chan_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+
+    CHECK_GOTO(pcnt_unit_add_watch_point(re->pcnt_unit, CONFIG_RE_PCNT_COUNTS_PER_STEP));
+    CHECK_GOTO(pcnt_unit_add_watch_point(re->pcnt_unit, -CONFIG_RE_PCNT_COUNTS_PER_STEP));
+    pcnt_event_callbacks_t cbs = {
+        .on_reach = pcnt_reach_callback,
+    };
+    CHECK_GOTO(pcnt_unit_register_event_callbacks(re->pcnt_unit, &cbs, re));
+
+    CHECK_GOTO(pcnt_unit_enable(re->pcnt_unit));
+    enabled = true;
+    CHECK_GOTO(pcnt_unit_clear_count(re->pcnt_unit));
+    CHECK_GOTO(pcnt_unit_start(re->pcnt_unit));
+
+    return ESP_OK;
+
+fail:
+    // unit must be disabled and free of channels before deletion
+    if (enabled)
+        pcnt_unit_disable(re->pcnt_unit);
+    if (re->pcnt_chan_a)
+        pcnt_del_channel(re->pcnt_chan_a);
+    if (re->pcnt_chan_b)
+        pcnt_del_channel(re->pcnt_chan_b);
+    pcnt_del_unit(re->pcnt_unit);
+    re->pcnt_unit = NULL;
+    re->pcnt_chan_a = NULL;
+    re->pcnt_chan_b = NULL;
+
+    return res;
+}
+
+static esp_err_t pcnt_deinit(rotary_encoder_t *re)
+{
+    CHECK(pcnt_unit_stop(re->pcnt_unit));
+    CHECK(pcnt_unit_disable(re->pcnt_unit));
+    CHECK(pcnt_del_channel(re->pcnt_chan_a));
+    CHECK(pcnt_del_channel(re->pcnt_chan_b));
+    CHECK(pcnt_del_unit(re->pcnt_unit));
+    re->pcnt_unit = NULL;
+
+    return ESP_OK;
+}
+
+#endif
+
 inline static void read_encoder(rotary_encoder_t *re)
 {
     rotary_encoder_event_t ev = {
@@ -116,6 +259,11 @@ inline static void read_encoder(rotary_encoder_t *re)
         }
     } while(0);
 
+#if CONFIG_RE_USE_PCNT
+    // rotation is handled by PCNT interrupt
+    return;
+#endif
+
     re->code <<= 2;
     re->code |= gpio_get_level(re->pin_a);
     re->code |= gpio_get_level(re->pin_b) << 1;
@@ -133,26 +281,7 @@ inline static void read_encoder(rotary_encoder_t *re)
 
     if (inc)
     {
-        ev.diff = inc;
-        if (re->acceleration.coeff > 1)
-        {        
-            int64_t nowMicros = esp_timer_get_time();
-            // at 200 ms, we want to have minimum acceleration
-            uint32_t accelerationMinCutoffMillis = CONFIG_RE_ACCELERATION_MIN_CUTOFF;
-            // at 4 ms, we want to have maximum acceleration
-            uint32_t accelerationMaxCutoffMillis = CONFIG_RE_ACCELERATION_MAX_CUTOFF;
-            uint32_t millisAfterLastMotion = (nowMicros - re->acceleration.last_time) / 1000u;
-            re->acceleration.last_time = nowMicros;
-
-            if (millisAfterLastMotion < accelerationMinCutoffMillis)
-            {
-                if (millisAfterLastMotion < accelerationMaxCutoffMillis)
-                {
-                    millisAfterLastMotion = accelerationMaxCutoffMillis; // limit to maximum acceleration
-                }
-                ev.diff = inc * ((int32_t)(re->acceleration.coeff / millisAfterLastMotion) == 0 ? 1 : (int32_t)(re->acceleration.coeff / millisAfterLastMotion));
-            }
-        }
+        ev.diff = make_step(re, inc);
 
         re->store = 0;
         ev.type = RE_ET_CHANGED;
@@ -240,10 +369,32 @@ esp_err_t rotary_encoder_add(rotary_encoder_t *re)
     io_conf.pin_bit_mask = GPIO_BIT(re->pin_a) | GPIO_BIT(re->pin_b);
     if (re->pin_btn < GPIO_NUM_MAX)
         io_conf.pin_bit_mask |= GPIO_BIT(re->pin_btn);
-    CHECK(gpio_config(&io_conf));
+    esp_err_t res = gpio_config(&io_conf);
+    if (res != ESP_OK)
+    {
+        encs[re->index] = NULL;
+        xSemaphoreGive(mutex);
+        return res;
+    }
 
     re->btn_state = RE_BTN_RELEASED;
     re->btn_pressed_time_us = 0;
+    memset(&re->motion, 0, sizeof(re->motion));
+
+#if CONFIG_RE_USE_PCNT
+    res = pcnt_init(re);
+    if (res != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to setup PCNT: %d (%s)", res, esp_err_to_name(res));
+        gpio_reset_pin(re->pin_a);
+        gpio_reset_pin(re->pin_b);
+        if (re->pin_btn < GPIO_NUM_MAX)
+            gpio_reset_pin(re->pin_btn);
+        encs[re->index] = NULL;
+        xSemaphoreGive(mutex);
+        return res;
+    }
+#endif
 
     xSemaphoreGive(mutex);
 
@@ -264,6 +415,11 @@ esp_err_t rotary_encoder_remove(rotary_encoder_t *re)
         if (encs[i] == re)
         {
             encs[i] = NULL;
+#if CONFIG_RE_USE_PCNT
+            esp_err_t res = pcnt_deinit(re);
+            if (res != ESP_OK)
+                ESP_LOGE(TAG, "Failed to free PCNT: %d (%s)", res, esp_err_to_name(res));
+#endif
             ESP_LOGI(TAG, "Removed rotary encoder %d", i);
             xSemaphoreGive(mutex);
             return ESP_OK;
@@ -288,3 +444,57 @@ esp_err_t rotary_encoder_disable_acceleration(rotary_encoder_t *re)
     re->acceleration.coeff = 0;
     return ESP_OK;
 }
+
+esp_err_t rotary_encoder_get_velocity(rotary_encoder_t *re, float *velocity, float *acceleration)
+{
+    CHECK_ARG(re && velocity);
+
+    int64_t time[RE_MOTION_HISTORY];
+    int8_t dir[RE_MOTION_HISTORY];
+
+    // copy history in chronological order
+    PORT_ENTER_CRITICAL();
+    uint8_t len = re->motion.len;
+    uint8_t first = (re->motion.pos + RE_MOTION_HISTORY - len) % RE_MOTION_HISTORY;
+    for (uint8_t i = 0; i < len; i++)
+    {
+        time[i] = re->motion.time[(first + i) % RE_MOTION_HISTORY];
+        dir[i] = re->motion.dir[(first + i) % RE_MOTION_HISTORY];
+    }
+    PORT_EXIT_CRITICAL();
+
+    *velocity = 0;
+    if (acceleration)
+        *acceleration = 0;
+    if (len < 2)
+        return ESP_OK;
+
+    // steps after the first one over the time they took
+    int32_t steps = 0;
+    for (uint8_t i = 1; i < len; i++)
+        steps += dir[i];
+    float v = steps * 1000000.0f / (time[len - 1] - time[0]);
+
+    // encoder stopped: can't be faster than one step since the last one
+    float bound = 1000000.0f / (esp_timer_get_time() - time[len - 1]);
+    if (fabsf(v) > bound)
+        v = v > 0 ? bound : -bound;
+    *velocity = v;
+
+    if (!acceleration || len < 4)
+        return ESP_OK;
+
+    // velocity change between two halves of history
+    uint8_t half = len / 2;
+    int32_t s1 = 0, s2 = 0;
+    for (uint8_t i = 1; i <= half; i++)
+        s1 += dir[i];
+    for (uint8_t i = half + 1; i < len; i++)
+        s2 += dir[i];
+    float v1 = s1 * 1000000.0f / (time[half] - time[0]);
+    float v2 = s2 * 1000000.0f / (time[len - 1] - time[half]);
+    float dt = ((time[len - 1] + time[half]) - (time[half] + time[0])) / 2000000.0f;
+    *acceleration = (v2 - v1) / dt;
+
+    return ESP_OK;
+}
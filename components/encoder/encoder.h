@@ -43,6 +43,9 @@
 #include <driver/gpio.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#if CONFIG_RE_USE_PCNT
+#include <driver/pulse_cnt.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -62,6 +65,17 @@ typedef struct {
     int64_t last_time;
     uint16_t coeff;
 } rotary_encoder_acceleration_t;
+
+#define RE_MOTION_HISTORY 8 //!< Number of steps used for velocity estimation
+
+//Timestamps of the last steps for velocity estimation
+typedef struct {
+    int64_t time[RE_MOTION_HISTORY];
+    int8_t dir[RE_MOTION_HISTORY];
+    uint8_t pos;
+    uint8_t len;
+} rotary_encoder_motion_t;
+
 /**
  * Rotary encoder descriptor
  */
@@ -74,6 +88,11 @@ typedef struct
     uint64_t btn_pressed_time_us;
     rotary_encoder_btn_state_t btn_state;
     rotary_encoder_acceleration_t acceleration;
+    rotary_encoder_motion_t motion;
+#if CONFIG_RE_USE_PCNT
+    pcnt_unit_handle_t pcnt_unit;
+    pcnt_channel_handle_t pcnt_chan_a, pcnt_chan_b;
+#endif
 } rotary_encoder_t;
 
 /**
@@ -138,6 +157,19 @@ esp_err_t rotary_encoder_enable_acceleration(rotary_encoder_t *re, uint16_t coef
  */
 esp_err_t rotary_encoder_disable_acceleration(rotary_encoder_t *re);
 
+/**
+ * @brief Estimate rotation velocity and acceleration
+ *
+ * Estimation is based on timestamps of the last ::RE_MOTION_HISTORY steps.
+ * When encoder stops, velocity decays as 1 / (time since last step).
+ *
+ * @param re Encoder descriptor
+ * @param[out] velocity Velocity, steps per second, positive for clockwise rotation
+ * @param[out] acceleration Acceleration, steps per second^2. May be NULL
+ * @return `ESP_OK` on success
+ */
+esp_err_t rotary_encoder_get_velocity(rotary_encoder_t *re, float *velocity, float *acceleration);
+
 #ifdef __cplusplus
 }
 #endif
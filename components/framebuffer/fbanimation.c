@@ -30,6 +30,7 @@
  *
  * MIT Licensed as described in the file LICENSE
  */
+#include <string.h>
 #include <esp_err.h>
 #include <esp_log.h>
 #include "fbanimation.h"
@@ -39,23 +40,88 @@ static const char *TAG = "animation";
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 
-static void display_frame(void *ctx)
+#define TASK_STACK_SIZE 4096
+#define JITTER_BIN_0_US 100
+
+static void deadline_cb(void *ctx)
 {
     fb_animation_t *animation = (fb_animation_t *)ctx;
 
+    xTaskNotifyGive(animation->task);
+}
+
+static inline uint32_t update_time(uint32_t *last, uint32_t *max, uint64_t *total, int64_t us)
+{
+    *last = (uint32_t)us;
+    if (*last > *max)
+        *max = *last;
+    *total += *last;
+    return *last;
+}
+
+static void display_frame(fb_animation_t *animation)
+{
+    int64_t start = esp_timer_get_time();
+
     // run effect
     esp_err_t res = animation->draw ? animation->draw(animation->fb) : ESP_FAIL;
+    int64_t drawn = esp_timer_get_time();
     if (res != ESP_OK)
-    {
         ESP_LOGE(TAG, "Error running effect %d (%s)", res, esp_err_to_name(res));
-        return;
-    }
     // render frame
-    res = fb_render(animation->fb, animation->render_ctx);
-    if (res != ESP_OK)
-    {
+    else if ((res = fb_render(animation->fb, animation->render_ctx)) != ESP_OK)
         ESP_LOGE(TAG, "Error rendering frame %d (%s)", res, esp_err_to_name(res));
-        return;
+    int64_t rendered = esp_timer_get_time();
+
+    size_t bin = 0;
+    for (int64_t late = start - animation->deadline_us;
+            bin < FB_ANIMATION_JITTER_BINS - 1 && late >= (JITTER_BIN_0_US << bin); bin++);
+
+    // skip frames whose deadlines have already passed
+    uint32_t missed = 0;
+    animation->deadline_us += animation->period_us;
+    if (rendered >= animation->deadline_us)
+    {
+        missed = (rendered - animation->deadline_us) / animation->period_us + 1;
+        animation->deadline_us += missed * animation->period_us;
+    }
+
+    portENTER_CRITICAL(&animation->stats_lock);
+    fb_animation_stats_t *st = &animation->stats;
+    if (res == ESP_OK)
+        st->frames++;
+    else
+        st->errors++;
+    st->missed += missed;
+    st->jitter[bin]++;
+    update_time(&st->draw_us, &st->draw_max_us, &st->draw_total_us, drawn - start);
+    update_time(&st->render_us, &st->render_max_us, &st->render_total_us, rendered - drawn);
+    portEXIT_CRITICAL(&animation->stats_lock);
+
+    // deadline may have passed while updating statistics, start right away then
+    int64_t timeout = animation->deadline_us - esp_timer_get_time();
+    if ((res = esp_timer_start_once(animation->timer, timeout > 0 ? timeout : 0)) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error starting frame timer %d (%s)", res, esp_err_to_name(res));
+        portENTER_CRITICAL(&animation->stats_lock);
+        st->errors++;
+        portEXIT_CRITICAL(&animation->stats_lock);
+    }
+}
+
+static void animation_task(void *arg)
+{
+    fb_animation_t *animation = (fb_animation_t *)arg;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        xSemaphoreTake(animation->lock, portMAX_DELAY);
+        // ignore stale notifications left from the previous play
+        if (animation->playing && esp_timer_get_time() >= animation->deadline_us)
+            display_frame(animation);
+        xSemaphoreGive(animation->lock);
     }
 }
 
@@ -65,36 +131,114 @@ esp_err_t fb_animation_init(fb_animation_t *animation, framebuffer_t *fb)
 {
     CHECK_ARG(animation && fb);
 
+    memset(animation, 0, sizeof(fb_animation_t));
     animation->fb = fb;
-    animation->timer = NULL;
+    portMUX_INITIALIZE(&animation->stats_lock);
+
+    animation->lock = xSemaphoreCreateMutex();
+    if (!animation->lock)
+        return ESP_ERR_NO_MEM;
+
     esp_timer_create_args_t timer_args = {
         .arg = animation,
-        .callback = display_frame,
+        .callback = deadline_cb,
         .dispatch_method = ESP_TIMER_TASK,
+        .name = "fb_animation",
     };
-    return esp_timer_create(&timer_args, &animation->timer);
+    esp_err_t res = esp_timer_create(&timer_args, &animation->timer);
+    if (res != ESP_OK)
+    {
+        vSemaphoreDelete(animation->lock);
+        return res;
+    }
+
+    if (xTaskCreate(animation_task, "fb_animation", TASK_STACK_SIZE, animation,
+                    FB_ANIMATION_DEFAULT_PRIORITY, &animation->task) != pdPASS)
+    {
+        esp_timer_delete(animation->timer);
+        vSemaphoreDelete(animation->lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t fb_animation_set_priority(fb_animation_t *animation, UBaseType_t priority)
+{
+    CHECK_ARG(animation && animation->task);
+
+    vTaskPrioritySet(animation->task, priority);
+
+    return ESP_OK;
 }
 
 esp_err_t fb_animation_play(fb_animation_t *animation, uint8_t fps, fb_draw_cb_t draw, void *render_ctx)
 {
     CHECK_ARG(animation && fps && draw);
 
+    CHECK(fb_animation_stop(animation));
+
+    xSemaphoreTake(animation->lock, portMAX_DELAY);
     animation->render_ctx = render_ctx;
     animation->draw = draw;
-    return esp_timer_start_periodic(animation->timer, 1000000 / fps);
+    animation->period_us = 1000000 / fps;
+    animation->deadline_us = esp_timer_get_time();
+    animation->playing = true;
+    xSemaphoreGive(animation->lock);
+
+    xTaskNotifyGive(animation->task);
+
+    return ESP_OK;
 }
 
 esp_err_t fb_animation_stop(fb_animation_t *animation)
 {
     CHECK_ARG(animation);
 
-    return esp_timer_stop(animation->timer);
+    xSemaphoreTake(animation->lock, portMAX_DELAY);
+    animation->playing = false;
+    esp_timer_stop(animation->timer);
+    xSemaphoreGive(animation->lock);
+
+    return ESP_OK;
 }
 
 esp_err_t fb_animation_free(fb_animation_t *animation)
 {
     CHECK_ARG(animation);
 
-    esp_timer_stop(animation->timer);
-    return esp_timer_delete(animation->timer);
+    CHECK(fb_animation_stop(animation));
+
+    xSemaphoreTake(animation->lock, portMAX_DELAY);
+    vTaskDelete(animation->task);
+    animation->task = NULL;
+    esp_timer_delete(animation->timer);
+    animation->timer = NULL;
+    xSemaphoreGive(animation->lock);
+    vSemaphoreDelete(animation->lock);
+    animation->lock = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t fb_animation_get_stats(fb_animation_t *animation, fb_animation_stats_t *stats)
+{
+    CHECK_ARG(animation && stats);
+
+    portENTER_CRITICAL(&animation->stats_lock);
+    *stats = animation->stats;
+    portEXIT_CRITICAL(&animation->stats_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t fb_animation_reset_stats(fb_animation_t *animation)
+{
+    CHECK_ARG(animation);
+
+    portENTER_CRITICAL(&animation->stats_lock);
+    memset(&animation->stats, 0, sizeof(fb_animation_stats_t));
+    portEXIT_CRITICAL(&animation->stats_lock);
+
+    return ESP_OK;
 }
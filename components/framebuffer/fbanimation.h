@@ -36,17 +36,49 @@
 #define __FBANIMATION_H__
 
 #include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 #include "framebuffer.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Default priority of animation task
+ */
+#define FB_ANIMATION_DEFAULT_PRIORITY 5
+
+/**
+ * Number of bins of frame start jitter histogram. Bin `i` counts frames
+ * started less than `100 << i` us after their deadline, the last bin
+ * counts all the rest.
+ */
+#define FB_ANIMATION_JITTER_BINS 8
+
 /**
  * Draw funtion type
  */
 typedef esp_err_t (*fb_draw_cb_t)(framebuffer_t *fb);
 
+/**
+ * Animation statistics
+ */
+typedef struct
+{
+    uint32_t frames;           ///< Number of displayed frames
+    uint32_t missed;           ///< Number of frames skipped because of overruns
+    uint32_t errors;           ///< Number of failed draw or render calls
+    uint32_t draw_us;          ///< Duration of the last draw call, us
+    uint32_t draw_max_us;      ///< Maximal duration of draw call, us
+    uint64_t draw_total_us;    ///< Total duration of draw calls, us
+    uint32_t render_us;        ///< Duration of the last render call, us
+    uint32_t render_max_us;    ///< Maximal duration of render call, us
+    uint64_t render_total_us;  ///< Total duration of render calls, us
+    uint32_t jitter[FB_ANIMATION_JITTER_BINS]; ///< Histogram of frame start delays relative to deadlines
+} fb_animation_stats_t;
+
 /**
  * Animation descriptor
  */
@@ -54,19 +86,40 @@ typedef struct
 {
     framebuffer_t *fb;         ///< Framebuffer descriptor
     void *render_ctx;          ///< Renderer context
-    esp_timer_handle_t timer;  ///< Animation timer
+    esp_timer_handle_t timer;  ///< Frame deadline timer
     fb_draw_cb_t draw;         ///< Draw function
+    TaskHandle_t task;         ///< Animation task
+    SemaphoreHandle_t lock;    ///< Held by the task while displaying frame
+    portMUX_TYPE stats_lock;   ///< Statistics spinlock
+    fb_animation_stats_t stats; ///< Statistics, use ::fb_animation_get_stats() to read
+    int64_t period_us;         ///< Frame period, us
+    int64_t deadline_us;       ///< Time of the next frame since boot, us
+    bool playing;              ///< true while animation is playing
 } fb_animation_t;
 
 /**
  * @brief Create animation based on LED effect
  *
+ * Animation is run by its own task with ::FB_ANIMATION_DEFAULT_PRIORITY.
+ * Frames are paced by deadlines: if drawing and rendering of a frame take
+ * longer than the frame period, missed frames are skipped instead of
+ * being displayed late.
+ *
  * @param animation     Animation descriptor
  * @param fb            Framebuffer descriptor
  * @return              ESP_OK on success
  */
 esp_err_t fb_animation_init(fb_animation_t *animation, framebuffer_t *fb);
 
+/**
+ * @brief Change priority of animation task
+ *
+ * @param animation     Animation descriptor
+ * @param priority      Task priority
+ * @return              ESP_OK on success
+ */
+esp_err_t fb_animation_set_priority(fb_animation_t *animation, UBaseType_t priority);
+
 /**
  * @brief Play animation
  *
@@ -81,6 +134,8 @@ esp_err_t fb_animation_play(fb_animation_t *animation, uint8_t fps, fb_draw_cb_t
 /**
  * @brief Stop playing animation
  *
+ * Function waits until the frame being displayed is finished.
+ *
  * @param animation     Animation descriptor
  * @return              ESP_OK on success
  */
@@ -94,6 +149,23 @@ esp_err_t fb_animation_stop(fb_animation_t *animation);
  */
 esp_err_t fb_animation_free(fb_animation_t *animation);
 
+/**
+ * @brief Get animation statistics
+ *
+ * @param animation     Animation descriptor
+ * @param[out] stats    Statistics
+ * @return              ESP_OK on success
+ */
+esp_err_t fb_animation_get_stats(fb_animation_t *animation, fb_animation_stats_t *stats);
+
+/**
+ * @brief Reset animation statistics
+ *
+ * @param animation     Animation descriptor
+ * @return              ESP_OK on success
+ */
+esp_err_t fb_animation_reset_stats(fb_animation_t *animation);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,15 +31,88 @@
  * MIT Licensed as described in the file LICENSE
  */
 #include <stdlib.h>
+#include <string.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
 #include "framebuffer.h"
 
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 #define CHECK(x) do { esp_err_t __; if ((__ = (x)) != ESP_OK) return __; } while (0)
 
-static size_t xy(void *ctx, size_t x, size_t y)
+#define RENDER_TASK_STACK_SIZE 4096
+
+struct fb_dbuf_s
+{
+    framebuffer_t front;        // descriptor passed to the renderer, data points to the front buffer
+    TaskHandle_t task;
+    SemaphoreHandle_t idle;     // given by the render task when the front buffer is released
+    void *render_ctx;
+    esp_err_t render_res;       // result of the last rendered frame
+    fb_region_t prev_dirty;     // changes of the previous frame, the back buffer lacks them without preserve
+    bool preserve;
+};
+
+static inline void region_full(framebuffer_t *fb, fb_region_t *r)
+{
+    r->x0 = r->y0 = 0;
+    r->x1 = fb->width;
+    r->y1 = fb->height;
+}
+
+static inline void region_clear(fb_region_t *r)
+{
+    r->x0 = r->y0 = r->x1 = r->y1 = 0;
+}
+
+static void region_add(fb_region_t *r, size_t x0, size_t y0, size_t x1, size_t y1)
+{
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    if (FB_REGION_EMPTY(r))
+    {
+        r->x0 = x0;
+        r->y0 = y0;
+        r->x1 = x1;
+        r->y1 = y1;
+        return;
+    }
+    if (x0 < r->x0) r->x0 = x0;
+    if (y0 < r->y0) r->y0 = y0;
+    if (x1 > r->x1) r->x1 = x1;
+    if (y1 > r->y1) r->y1 = y1;
+}
+
+static void render_task(void *arg)
+{
+    framebuffer_t *fb = (framebuffer_t *)arg;
+    fb_dbuf_t *dbuf = fb->dbuf;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        dbuf->render_res = fb->render(&dbuf->front, dbuf->render_ctx);
+        xSemaphoreGive(dbuf->idle);
+    }
+}
+
+static void free_double_buffer(framebuffer_t *fb)
 {
-    framebuffer_t *fb = (framebuffer_t *)ctx;
-    return y * fb->width + x;
+    fb_dbuf_t *dbuf = fb->dbuf;
+    if (!dbuf)
+        return;
+
+    if (dbuf->task)
+    {
+        // wait until the last frame is rendered, task is blocked on notification then
+        xSemaphoreTake(dbuf->idle, portMAX_DELAY);
+        vTaskDelete(dbuf->task);
+    }
+    if (dbuf->idle)
+        vSemaphoreDelete(dbuf->idle);
+    if (dbuf->front.data)
+        free(dbuf->front.data);
+    free(dbuf);
+    fb->dbuf = NULL;
 }
 
 esp_err_t fb_init(framebuffer_t *fb, size_t width, size_t height, fb_render_cb_t render_cb)
@@ -52,6 +125,8 @@ esp_err_t fb_init(framebuffer_t *fb, size_t width, size_t height, fb_render_cb_t
     fb->last_frame_us = 0;
     fb->render = render_cb;
     fb->internal = NULL;
+    fb->dbuf = NULL;
+    region_full(fb, &fb->dirty);
     fb->mutex = xSemaphoreCreateMutex();
     if (!fb->mutex)
         return ESP_ERR_NO_MEM;
@@ -62,10 +137,50 @@ esp_err_t fb_init(framebuffer_t *fb, size_t width, size_t height, fb_render_cb_t
     return ESP_OK;
 }
 
+esp_err_t fb_init_double_buffer(framebuffer_t *fb, bool preserve, UBaseType_t priority)
+{
+    CHECK_ARG(fb && fb->data && fb->render);
+
+    if (fb->dbuf)
+        return ESP_ERR_INVALID_STATE;
+
+    fb_dbuf_t *dbuf = calloc(1, sizeof(fb_dbuf_t));
+    if (!dbuf)
+        return ESP_ERR_NO_MEM;
+    fb->dbuf = dbuf;
+
+    dbuf->front = *fb;
+    dbuf->front.dbuf = NULL;
+    dbuf->front.mutex = NULL;
+    dbuf->front.data = malloc(FB_SIZE(fb));
+    dbuf->idle = xSemaphoreCreateBinary();
+    if (!dbuf->front.data || !dbuf->idle)
+    {
+        free_double_buffer(fb);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(dbuf->front.data, fb->data, FB_SIZE(fb));
+    dbuf->preserve = preserve;
+    dbuf->render_res = ESP_OK;
+    region_clear(&dbuf->prev_dirty);
+    xSemaphoreGive(dbuf->idle);
+
+    if (xTaskCreate(render_task, "fb_render", RENDER_TASK_STACK_SIZE, fb, priority, &dbuf->task) != pdPASS)
+    {
+        dbuf->task = NULL;
+        free_double_buffer(fb);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t fb_free(framebuffer_t *fb)
 {
     CHECK_ARG(fb);
 
+    free_double_buffer(fb);
+
     if (fb->data)
         free(fb->data);
     if (fb->mutex)
@@ -80,9 +195,60 @@ esp_err_t fb_render(framebuffer_t *fb, void *render_ctx)
 
     if (xSemaphoreTake(fb->mutex, 0) != pdTRUE)
         return ESP_ERR_INVALID_STATE;
-    CHECK(fb->render(fb, render_ctx));
+
+    if (!fb->dbuf)
+    {
+        esp_err_t res = fb->render(fb, render_ctx);
+        if (res == ESP_OK)
+            region_clear(&fb->dirty);
+        xSemaphoreGive(fb->mutex);
+        return res;
+    }
+
+    fb_dbuf_t *dbuf = fb->dbuf;
+
+    // wait for the render task to release the front buffer
+    xSemaphoreTake(dbuf->idle, portMAX_DELAY);
+
+    rgb_t *front = dbuf->front.data;
+    dbuf->front.data = fb->data;
+    dbuf->front.frame_num = fb->frame_num;
+    dbuf->front.last_frame_us = fb->last_frame_us;
+    dbuf->front.internal = fb->internal;
+    dbuf->render_ctx = render_ctx;
+    fb->data = front;
+    esp_err_t res = dbuf->render_res;
+
+    // front buffer differs from the displayed frame by the changes of this frame
+    // and, if the back buffer was not synced, of the previous one too
+    dbuf->front.dirty = fb->dirty;
+    if (res != ESP_OK)
+        region_full(fb, &dbuf->front.dirty);
+    else if (!dbuf->preserve)
+        region_add(&dbuf->front.dirty, dbuf->prev_dirty.x0, dbuf->prev_dirty.y0,
+                   dbuf->prev_dirty.x1, dbuf->prev_dirty.y1);
+    dbuf->prev_dirty = fb->dirty;
+    region_clear(&fb->dirty);
+
+    xTaskNotifyGive(dbuf->task);
+
+    // the front buffer is only read by the renderer so it's safe to copy it concurrently
+    if (dbuf->preserve)
+        memcpy(fb->data, dbuf->front.data, FB_SIZE(fb));
+
     xSemaphoreGive(fb->mutex);
 
+    return res;
+}
+
+esp_err_t fb_mark_dirty(framebuffer_t *fb, size_t x, size_t y, size_t width, size_t height)
+{
+    CHECK_ARG(fb && x < fb->width && y < fb->height);
+
+    region_add(&fb->dirty, x, y,
+               width > fb->width - x ? fb->width : x + width,
+               height > fb->height - y ? fb->height : y + height);
+
     return ESP_OK;
 }
 
@@ -91,6 +257,7 @@ esp_err_t fb_set_pixel_rgb(framebuffer_t *fb, size_t x, size_t y, rgb_t color)
     CHECK_ARG(fb && fb->data && x < fb->width && y < fb->height);
 
     fb->data[FB_OFFSET(fb, x, y)] = color;
+    region_add(&fb->dirty, x, y, x + 1, y + 1);
 
     return ESP_OK;
 }
@@ -100,6 +267,7 @@ esp_err_t fb_set_pixel_hsv(framebuffer_t *fb, size_t x, size_t y, hsv_t color)
     CHECK_ARG(fb && fb->data && x < fb->width && y < fb->height);
 
     fb->data[FB_OFFSET(fb, x, y)] = hsv2rgb_rainbow(color);
+    region_add(&fb->dirty, x, y, x + 1, y + 1);
 
     return ESP_OK;
 }
@@ -124,49 +292,129 @@ esp_err_t fb_get_pixel_hsv(framebuffer_t *fb, size_t x, size_t y, hsv_t *color)
 
 #define WU_WEIGHT(a, b) ((uint8_t)(((a) * (b) + (a) + (b)) >> 8))
 
-esp_err_t fb_set_pixelf_rgb(framebuffer_t *fb, float x, float y, rgb_t color)
+// saturating-add color multiplied by intensity to the pixel, if it is inside of framebuffer
+static void blend_pixel(framebuffer_t *fb, int32_t x, int32_t y, rgb_t color, uint8_t w)
 {
-    CHECK_ARG(fb && fb->data);
+    if (!w || x < 0 || y < 0 || (size_t)x >= fb->width || (size_t)y >= fb->height)
+        return;
+    rgb_t *clr = fb->data + FB_OFFSET(fb, x, y);
+    clr->r = qadd8(clr->r, (color.r * w) >> 8);
+    clr->g = qadd8(clr->g, (color.g * w) >> 8);
+    clr->b = qadd8(clr->b, (color.b * w) >> 8);
+    region_add(&fb->dirty, x, y, x + 1, y + 1);
+}
+
+static void set_pixelx(framebuffer_t *fb, saccum1516 x, saccum1516 y, rgb_t color)
+{
+    int32_t xi = FIXED_INT(x);
+    int32_t yi = FIXED_INT(y);
 
     // extract the fractional parts and derive their inverses
-    uint8_t xx = (x - (int)x) * 255;
-    uint8_t yy = (y - (int)y) * 255;
+    uint8_t xx = FIXED_FRAC(x) >> 8;
+    uint8_t yy = FIXED_FRAC(y) >> 8;
     uint8_t ix = 255 - xx;
     uint8_t iy = 255 - yy;
 
-    // calculate the intensities for each affected pixel
-    uint8_t weights[4] = {
-        WU_WEIGHT(ix, iy),
-        WU_WEIGHT(xx, iy),
-        WU_WEIGHT(ix, yy),
-        WU_WEIGHT(xx, yy)
-    };
     // multiply the intensities by the colour, and saturating-add them to the pixels
-    for (uint8_t i = 0; i < 4; i++)
-    {
-        int xn = x + (i & 1);
-        int yn = y + ((i >> 1) & 1);
-        rgb_t clr = { 0 };
-        fb_get_pixel_rgb(fb, xn, yn, &clr);
-        clr.r = qadd8(clr.r, (color.r * weights[i]) >> 8);
-        clr.g = qadd8(clr.g, (color.g * weights[i]) >> 8);
-        clr.b = qadd8(clr.b, (color.b * weights[i]) >> 8);
-        fb_set_pixel_rgb(fb, xn, yn, clr);
-    }
+    blend_pixel(fb, xi, yi, color, WU_WEIGHT(ix, iy));
+    blend_pixel(fb, xi + 1, yi, color, WU_WEIGHT(xx, iy));
+    blend_pixel(fb, xi, yi + 1, color, WU_WEIGHT(ix, yy));
+    blend_pixel(fb, xi + 1, yi + 1, color, WU_WEIGHT(xx, yy));
+}
+
+esp_err_t fb_set_pixelx_rgb(framebuffer_t *fb, saccum1516 x, saccum1516 y, rgb_t color)
+{
+    CHECK_ARG(fb && fb->data);
+
+    set_pixelx(fb, x, y, color);
 
     return ESP_OK;
 }
 
+esp_err_t fb_set_pixelx_hsv(framebuffer_t *fb, saccum1516 x, saccum1516 y, hsv_t color)
+{
+    return fb_set_pixelx_rgb(fb, x, y, hsv2rgb_rainbow(color));
+}
+
+esp_err_t fb_set_pixelf_rgb(framebuffer_t *fb, float x, float y, rgb_t color)
+{
+    return fb_set_pixelx_rgb(fb, FIXED_FROM_FLOAT(x), FIXED_FROM_FLOAT(y), color);
+}
+
 esp_err_t fb_set_pixelf_hsv(framebuffer_t *fb, float x, float y, hsv_t color)
 {
     return fb_set_pixelf_rgb(fb, x, y, hsv2rgb_rainbow(color));
 }
 
+esp_err_t fb_draw_line_aa(framebuffer_t *fb, saccum1516 x0, saccum1516 y0, saccum1516 x1, saccum1516 y1, rgb_t color)
+{
+    CHECK_ARG(fb && fb->data);
+
+    saccum1516 t;
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep)
+    {
+        t = x0; x0 = y0; y0 = t;
+        t = x1; x1 = y1; y1 = t;
+    }
+    if (x0 > x1)
+    {
+        t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    saccum1516 dx = x1 - x0;
+    saccum1516 gradient = dx ? div1516(y1 - y0, dx) : FIXED_ONE;
+
+    // walk the major axis by whole pixels, split intensity along the minor one
+    int32_t xs = FIXED_INT(x0 + FIXED_ONE / 2);
+    int32_t xe = FIXED_INT(x1 + FIXED_ONE / 2);
+    saccum1516 intery = y0 + mul1516(gradient, FIXED_FROM_INT(xs) - x0);
+    for (int32_t x = xs; x <= xe; x++, intery += gradient)
+    {
+        int32_t y = FIXED_INT(intery);
+        uint8_t f = FIXED_FRAC(intery) >> 8;
+        if (steep)
+        {
+            blend_pixel(fb, y, x, color, 255 - f);
+            blend_pixel(fb, y + 1, x, color, f);
+        }
+        else
+        {
+            blend_pixel(fb, x, y, color, 255 - f);
+            blend_pixel(fb, x, y + 1, color, f);
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t fb_draw_circle_aa(framebuffer_t *fb, saccum1516 cx, saccum1516 cy, saccum1516 r, rgb_t color)
+{
+    CHECK_ARG(fb && fb->data && r >= 0);
+
+    // about one point per pixel of circumference
+    uint32_t steps = FIXED_INT(mul1516(r, FIXED_FROM_FLOAT(6.2832f))) + 1;
+    if (steps < 8)
+        steps = 8;
+    if (steps > 65536)
+        steps = 65536;
+
+    for (uint32_t i = 0; i < steps; i++)
+    {
+        uint16_t theta = (i << 16) / steps;
+        set_pixelx(fb, cx + mul1516(r, cos1516(theta)), cy + mul1516(r, sin1516(theta)), color);
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t fb_clear(framebuffer_t *fb)
 {
     CHECK_ARG(fb && fb->data);
 
     memset(fb->data, 0, FB_SIZE(fb));
+    region_full(fb, &fb->dirty);
 
     return ESP_OK;
 }
@@ -204,6 +452,7 @@ esp_err_t fb_shift(framebuffer_t *fb, size_t offs, fb_shift_direction_t dir)
                     FB_SIZE(fb) - offs * fb->width * sizeof(rgb_t));
             break;
     }
+    region_full(fb, &fb->dirty);
 
     return ESP_OK;
 }
@@ -212,8 +461,8 @@ esp_err_t fb_fade(framebuffer_t *fb, uint8_t scale)
 {
     CHECK_ARG(fb && fb->data);
 
-    for (size_t i = 0; i < fb->width * fb->height; i++)
-        fb->data[i] = rgb_fade(fb->data[i], scale);
+    rgb_bulk_fade(fb->data, fb->width * fb->height, scale);
+    region_full(fb, &fb->dirty);
 
     return ESP_OK;
 }
@@ -222,7 +471,8 @@ esp_err_t fb_blur2d(framebuffer_t *fb, fract8 amount)
 {
     CHECK_ARG(fb && fb->data);
 
-    blur2d(fb->data, fb->width, fb->height, amount, xy, fb);
+    blur2d_layout(fb->data, fb->width, fb->height, amount, MATRIX_LAYOUT_ROWS);
+    region_full(fb, &fb->dirty);
 
     return ESP_OK;
 }
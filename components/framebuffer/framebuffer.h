@@ -35,6 +35,7 @@
 #ifndef __FRAMEBUFFER_H__
 #define __FRAMEBUFFER_H__
 
+#include <stdbool.h>
 #include <esp_err.h>
 #include <color.h>
 #include <freertos/FreeRTOS.h>
@@ -55,8 +56,27 @@ typedef enum {
     FB_SHIFT_DOWN
 } fb_shift_direction_t;
 
+/**
+ * Rectangular framebuffer region, `x1` and `y1` are exclusive.
+ * Region is empty when `x0 >= x1` or `y0 >= y1`.
+ */
+typedef struct
+{
+    size_t x0;                     ///< Left column
+    size_t y0;                     ///< Top row
+    size_t x1;                     ///< Column next to the right one
+    size_t y1;                     ///< Row next to the bottom one
+} fb_region_t;
+
+/**
+ * Check if region is empty
+ */
+#define FB_REGION_EMPTY(r) ((r)->x0 >= (r)->x1 || (r)->y0 >= (r)->y1)
+
 typedef struct framebuffer_s framebuffer_t;
 
+typedef struct fb_dbuf_s fb_dbuf_t;
+
 /**
  * Renderer callback prototype
  */
@@ -75,6 +95,8 @@ struct framebuffer_s
     fb_render_cb_t render;         ///< See ::fb_render()
     uint8_t *internal;             ///< Buffer for effect settings, internal vars, palettes and so on
     SemaphoreHandle_t mutex;
+    fb_dbuf_t *dbuf;               ///< Double buffering state, NULL in single-buffered mode
+    fb_region_t dirty;             ///< Region changed since the last successful render
 };
 
 /**
@@ -89,6 +111,25 @@ struct framebuffer_s
  */
 esp_err_t fb_init(framebuffer_t *fb, size_t width, size_t height, fb_render_cb_t render_cb);
 
+/**
+ * @brief Switch framebuffer to double-buffered mode
+ *
+ * Second (front) buffer and render task are created. Effects keep drawing
+ * to `fb->data` (back buffer), while ::fb_render() flips back and front
+ * buffers and returns immediately. Renderer callback is then called from
+ * the render task with a framebuffer descriptor whose `data` points to the
+ * front buffer, so drawing of the next frame overlaps with transfer of the
+ * current one and the frame being transferred is never modified.
+ *
+ * @param fb        Framebuffer descriptor
+ * @param preserve  Copy the presented frame back to the back buffer after
+ *                  swap. Required by effects which modify the previous frame
+ *                  (fade, blur, shift) instead of drawing it from scratch
+ * @param priority  Render task priority
+ * @return          ESP_OK on success
+ */
+esp_err_t fb_init_double_buffer(framebuffer_t *fb, bool preserve, UBaseType_t priority);
+
 /**
  * @brief Free Framebuffer descriptor buffers
  *
@@ -103,12 +144,35 @@ esp_err_t fb_free(framebuffer_t *fb);
  * Rendering is performed by calling the callback function with passing
  * it as arguments \p fb and \p ctx
  *
+ * Renderer may use `fb->dirty` to transfer only the changed part of the
+ * frame. Dirty region is reset after successful rendering.
+ *
+ * In double-buffered mode function waits until the previous frame is
+ * rendered, swaps buffers and queues the new front buffer for the render
+ * task. Error returned by the renderer callback on the previous frame is
+ * returned in this case.
+ *
  * @param fb   Framebuffer descriptor
  * @param ctx  Argument to pass to callback
  * @return     ESP_OK on success
  */
 esp_err_t fb_render(framebuffer_t *fb, void *ctx);
 
+/**
+ * @brief Mark framebuffer region as changed
+ *
+ * Drawing functions of this module track changes automatically, this
+ * function is for the code which modifies `fb->data` directly.
+ *
+ * @param fb        Framebuffer descriptor
+ * @param x         Left column
+ * @param y         Top row
+ * @param width     Region width
+ * @param height    Region height
+ * @return          ESP_OK on success
+ */
+esp_err_t fb_mark_dirty(framebuffer_t *fb, size_t x, size_t y, size_t width, size_t height);
+
 /**
  * @brief Set RGB color of framebuffer pixel
  *
@@ -153,6 +217,62 @@ esp_err_t fb_set_pixelf_rgb(framebuffer_t *fb, float x, float y, rgb_t color);
  */
 esp_err_t fb_set_pixelf_hsv(framebuffer_t *fb, float x, float y, hsv_t color);
 
+/**
+ * @brief Set RGB pixel with fixed point subpixel resolution
+ *
+ * Color is distributed between four neighbouring pixels and
+ * saturating-added to them (Wu antialiasing).
+ *
+ * @param fb        Framebuffer descriptor
+ * @param x         X coordinate, Q16.16
+ * @param y         Y coordinate, Q16.16
+ * @param color     RGB color
+ * @return          ESP_OK on success
+ */
+esp_err_t fb_set_pixelx_rgb(framebuffer_t *fb, saccum1516 x, saccum1516 y, rgb_t color);
+
+/**
+ * @brief Set HSV pixel with fixed point subpixel resolution
+ *
+ * @param fb        Framebuffer descriptor
+ * @param x         X coordinate, Q16.16
+ * @param y         Y coordinate, Q16.16
+ * @param color     HSV color
+ * @return          ESP_OK on success
+ */
+esp_err_t fb_set_pixelx_hsv(framebuffer_t *fb, saccum1516 x, saccum1516 y, hsv_t color);
+
+/**
+ * @brief Draw antialiased line
+ *
+ * Xiaolin Wu's algorithm in fixed point, color is saturating-added
+ * to the framebuffer.
+ *
+ * @param fb        Framebuffer descriptor
+ * @param x0        X coordinate of the start point, Q16.16
+ * @param y0        Y coordinate of the start point, Q16.16
+ * @param x1        X coordinate of the end point, Q16.16
+ * @param y1        Y coordinate of the end point, Q16.16
+ * @param color     RGB color
+ * @return          ESP_OK on success
+ */
+esp_err_t fb_draw_line_aa(framebuffer_t *fb, saccum1516 x0, saccum1516 y0, saccum1516 x1, saccum1516 y1, rgb_t color);
+
+/**
+ * @brief Draw antialiased circle
+ *
+ * Circle is drawn with subpixel points, color is saturating-added
+ * to the framebuffer.
+ *
+ * @param fb        Framebuffer descriptor
+ * @param cx        X coordinate of the center, Q16.16
+ * @param cy        Y coordinate of the center, Q16.16
+ * @param r         Radius, Q16.16
+ * @param color     RGB color
+ * @return          ESP_OK on success
+ */
+esp_err_t fb_draw_circle_aa(framebuffer_t *fb, saccum1516 cx, saccum1516 cy, saccum1516 r, rgb_t color);
+
 /**
  * @brief Get RGB color of framebuffer pixel
  *
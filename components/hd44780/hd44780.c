@@ -90,16 +90,25 @@
 
 static const uint8_t line_addr[] = { 0x00, 0x40, 0x14, 0x54 };
 
+#define SCREEN_TASK_STACK_SIZE 2048
+// command + all characters of line, 4 register writes per byte
+#define SCREEN_LINE_BUF_SIZE ((HD44780_SCREEN_MAX_COLS + 1) * 4)
+
+static inline uint8_t nibble_data(const hd44780_t *lcd, uint8_t b, bool rs)
+{
+    return (((b >> 3) & 1) << lcd->pins.d7)
+         | (((b >> 2) & 1) << lcd->pins.d6)
+         | (((b >> 1) & 1) << lcd->pins.d5)
+         | ((b & 1) << lcd->pins.d4)
+         | (rs ? 1 << lcd->pins.rs : 0)
+         | (lcd->backlight ? 1 << lcd->pins.bl : 0);
+}
+
 static esp_err_t write_nibble(const hd44780_t *lcd, uint8_t b, bool rs)
 {
     if (lcd->write_cb)
     {
-        uint8_t data = (((b >> 3) & 1) << lcd->pins.d7)
-                     | (((b >> 2) & 1) << lcd->pins.d6)
-                     | (((b >> 1) & 1) << lcd->pins.d5)
-                     | ((b & 1) << lcd->pins.d4)
-                     | (rs ? 1 << lcd->pins.rs : 0)
-                     | (lcd->backlight ? 1 << lcd->pins.bl : 0);
+        uint8_t data = nibble_data(lcd, b, rs);
         CHECK(lcd->write_cb(lcd, data | (1 << lcd->pins.e)));
         toggle_delay();
         CHECK(lcd->write_cb(lcd, data));
@@ -289,3 +298,202 @@ esp_err_t hd44780_scroll_right(const hd44780_t *lcd)
 
     return ESP_OK;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+// register writes of one byte with E strobes: high nibble, then low nibble
+static inline uint8_t *pack_byte(const hd44780_t *lcd, uint8_t *p, uint8_t b, bool rs)
+{
+    uint8_t e = 1 << lcd->pins.e;
+    uint8_t hi = nibble_data(lcd, b >> 4, rs);
+    uint8_t lo = nibble_data(lcd, b, rs);
+    *p++ = hi | e;
+    *p++ = hi;
+    *p++ = lo | e;
+    *p++ = lo;
+    return p;
+}
+
+typedef struct
+{
+    const hd44780_t *lcd;
+    uint8_t buf[SCREEN_LINE_BUF_SIZE];
+    size_t len;
+    uint32_t bytes;
+} packer_t;
+
+static esp_err_t put_byte(packer_t *pk, uint8_t b, bool rs)
+{
+    pk->bytes++;
+    if (!pk->lcd->write_buf_cb)
+    {
+        CHECK(write_byte(pk->lcd, b, rs));
+        short_delay();
+        return ESP_OK;
+    }
+    pk->len = pack_byte(pk->lcd, pk->buf + pk->len, b, rs) - pk->buf;
+    return ESP_OK;
+}
+
+static esp_err_t put_flush(packer_t *pk)
+{
+    if (!pk->len)
+        return ESP_OK;
+    esp_err_t res = pk->lcd->write_buf_cb(pk->lcd, pk->buf, pk->len);
+    pk->len = 0;
+    return res;
+}
+
+static esp_err_t render_line(hd44780_screen_t *scr, packer_t *pk, uint8_t line)
+{
+    const char *frame = scr->frame[line];
+    const char *shown = scr->shown[line];
+
+    int cursor = -1; // column where LCD cursor is, -1 if elsewhere
+    for (uint8_t col = 0; col < scr->cols; col++)
+    {
+        if (frame[col] == shown[col])
+            continue;
+        // rewriting one unchanged cell is as cheap as moving cursor
+        if (cursor >= 0 && col - cursor == 1)
+            CHECK(put_byte(pk, frame[cursor], true));
+        else if (cursor != col)
+            CHECK(put_byte(pk, CMD_DDRAM_ADDR + line_addr[line] + col, false));
+        CHECK(put_byte(pk, frame[col], true));
+        cursor = col + 1;
+    }
+    // one transaction per line
+    return put_flush(pk);
+}
+
+static esp_err_t screen_render(hd44780_screen_t *scr)
+{
+    packer_t pk = { .lcd = scr->lcd };
+    esp_err_t res = ESP_OK;
+
+    for (uint8_t line = 0; line < scr->lcd->lines; line++)
+    {
+        if ((res = render_line(scr, &pk, line)) != ESP_OK)
+            break;
+        // line is on LCD only when sent, failed ones are resent by next flush
+        memcpy(scr->shown[line], scr->frame[line], scr->cols);
+    }
+    scr->bytes = pk.bytes;
+    scr->result = res;
+
+    return res;
+}
+
+static esp_err_t screen_render_locked(hd44780_screen_t *scr)
+{
+    xSemaphoreTake(scr->lock, portMAX_DELAY);
+    esp_err_t res = screen_render(scr);
+    xSemaphoreGive(scr->lock);
+
+    return res;
+}
+
+static void screen_task(void *arg)
+{
+    hd44780_screen_t *scr = (hd44780_screen_t *)arg;
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        screen_render_locked(scr);
+    }
+}
+
+esp_err_t hd44780_screen_init(hd44780_screen_t *scr, hd44780_t *lcd, uint8_t cols, UBaseType_t priority)
+{
+    CHECK_ARG(scr && lcd && cols && cols <= HD44780_SCREEN_MAX_COLS && lcd->lines <= HD44780_SCREEN_MAX_LINES);
+
+    memset(scr, 0, sizeof(hd44780_screen_t));
+    scr->lcd = lcd;
+    scr->cols = cols;
+    memset(scr->frame, ' ', sizeof(scr->frame));
+    memset(scr->shown, ' ', sizeof(scr->shown));
+
+    scr->lock = xSemaphoreCreateMutex();
+    if (!scr->lock)
+        return ESP_ERR_NO_MEM;
+
+    esp_err_t res = hd44780_clear(lcd);
+    if (res == ESP_OK && priority
+            && xTaskCreate(screen_task, "hd44780", SCREEN_TASK_STACK_SIZE, scr, priority, &scr->task) != pdPASS)
+        res = ESP_ERR_NO_MEM;
+    if (res != ESP_OK)
+    {
+        vSemaphoreDelete(scr->lock);
+        scr->lock = NULL;
+    }
+
+    return res;
+}
+
+esp_err_t hd44780_screen_free(hd44780_screen_t *scr)
+{
+    CHECK_ARG(scr && scr->lock);
+
+    if (scr->task)
+    {
+        // wait for the running flush to finish
+        xSemaphoreTake(scr->lock, portMAX_DELAY);
+        vTaskDelete(scr->task);
+        scr->task = NULL;
+        xSemaphoreGive(scr->lock);
+    }
+    vSemaphoreDelete(scr->lock);
+    scr->lock = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t hd44780_screen_clear(hd44780_screen_t *scr)
+{
+    CHECK_ARG(scr && scr->lock);
+
+    xSemaphoreTake(scr->lock, portMAX_DELAY);
+    memset(scr->frame, ' ', sizeof(scr->frame));
+    scr->col = scr->line = 0;
+    xSemaphoreGive(scr->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t hd44780_screen_gotoxy(hd44780_screen_t *scr, uint8_t col, uint8_t line)
+{
+    CHECK_ARG(scr && scr->lock && col < scr->cols && line < scr->lcd->lines);
+
+    xSemaphoreTake(scr->lock, portMAX_DELAY);
+    scr->col = col;
+    scr->line = line;
+    xSemaphoreGive(scr->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t hd44780_screen_puts(hd44780_screen_t *scr, const char *s)
+{
+    CHECK_ARG(scr && scr->lock && s);
+
+    xSemaphoreTake(scr->lock, portMAX_DELAY);
+    while (*s && scr->col < scr->cols)
+        scr->frame[scr->line][scr->col++] = *s++;
+    xSemaphoreGive(scr->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t hd44780_screen_flush(hd44780_screen_t *scr)
+{
+    CHECK_ARG(scr && scr->lock);
+
+    if (scr->task)
+    {
+        xTaskNotifyGive(scr->task);
+        return ESP_OK;
+    }
+
+    return screen_render_locked(scr);
+}
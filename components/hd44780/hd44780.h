@@ -43,8 +43,12 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <driver/gpio.h>
 #include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,6 +56,9 @@ extern "C" {
 
 #define HD44780_NOT_USED 0xff
 
+#define HD44780_SCREEN_MAX_COLS  40 //!< Maximal number of columns of screen buffer
+#define HD44780_SCREEN_MAX_LINES 4  //!< Maximal number of lines of screen buffer
+
 /**
  * LCD font type. Please refer to the datasheet
  * of your module.
@@ -66,6 +73,8 @@ typedef struct hd44780 hd44780_t;
 
 typedef esp_err_t (*hd44780_write_cb_t)(const hd44780_t *lcd, uint8_t data);
 
+typedef esp_err_t (*hd44780_write_buf_cb_t)(const hd44780_t *lcd, const uint8_t *data, size_t len);
+
 /**
  * LCD descriptor. Fill it before use.
  */
@@ -85,8 +94,28 @@ struct hd44780
     hd44780_font_t font;   //!< LCD Font type
     uint8_t lines;         //!< Number of lines for LCD. Many 16x1 LCD has two lines (like 8x2)
     bool backlight;        //!< Current backlight state
+    hd44780_write_buf_cb_t write_buf_cb; //!< Optional callback writing several bytes to the
+                           //!< register in one transaction, used together with `write_cb`.
+                           //!< Time between two bytes must be at least 10 us
 };
 
+/**
+ * Screen buffer descriptor
+ */
+typedef struct
+{
+    hd44780_t *lcd;                   //!< LCD descriptor
+    uint8_t cols;                     //!< Number of columns
+    uint8_t col;                      //!< Cursor column in buffer
+    uint8_t line;                     //!< Cursor line in buffer
+    char frame[HD44780_SCREEN_MAX_LINES][HD44780_SCREEN_MAX_COLS]; //!< Screen contents to display
+    char shown[HD44780_SCREEN_MAX_LINES][HD44780_SCREEN_MAX_COLS]; //!< Screen contents on LCD
+    SemaphoreHandle_t lock;           //!< Held while buffer is modified or sent to LCD
+    TaskHandle_t task;                //!< Background flush task, NULL for synchronous flush
+    uint32_t bytes;                   //!< Number of bytes sent to LCD by the last flush
+    esp_err_t result;                 //!< Result of the last flush, set by background task too
+} hd44780_screen_t;
+
 /**
  * @brief Init LCD
  *
@@ -185,6 +214,71 @@ esp_err_t hd44780_scroll_left(const hd44780_t *lcd);
  */
 esp_err_t hd44780_scroll_right(const hd44780_t *lcd);
 
+/**
+ * @brief Initialize screen buffer
+ *
+ * LCD must be initialized by ::hd44780_init() before calling this function,
+ * its contents are cleared.
+ *
+ * @param scr Screen buffer descriptor
+ * @param lcd LCD descriptor
+ * @param cols Number of LCD columns
+ * @param priority Priority of background flush task. 0 to flush synchronously
+ * @return `ESP_OK` on success
+ */
+esp_err_t hd44780_screen_init(hd44780_screen_t *scr, hd44780_t *lcd, uint8_t cols, UBaseType_t priority);
+
+/**
+ * @brief Stop background task and free screen buffer
+ *
+ * @param scr Screen buffer descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t hd44780_screen_free(hd44780_screen_t *scr);
+
+/**
+ * @brief Fill screen buffer with spaces and move cursor to (0, 0)
+ *
+ * @param scr Screen buffer descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t hd44780_screen_clear(hd44780_screen_t *scr);
+
+/**
+ * @brief Move screen buffer cursor
+ *
+ * @param scr Screen buffer descriptor
+ * @param col Column
+ * @param line Line
+ * @return `ESP_OK` on success
+ */
+esp_err_t hd44780_screen_gotoxy(hd44780_screen_t *scr, uint8_t col, uint8_t line);
+
+/**
+ * @brief Write NULL-terminated string to screen buffer at cursor position
+ *
+ * Text is clipped at the end of line.
+ *
+ * @param scr Screen buffer descriptor
+ * @param s String to write
+ * @return `ESP_OK` on success
+ */
+esp_err_t hd44780_screen_puts(hd44780_screen_t *scr, const char *s);
+
+/**
+ * @brief Send changed characters of screen buffer to LCD
+ *
+ * Only changed cells are sent, cursor is moved only over runs of unchanged
+ * cells. With `write_buf_cb` every changed line is sent in one transaction.
+ * If background task is used, function returns immediately and the result
+ * of the flush is stored in `result` field of the descriptor. Cells of
+ * lines failed to send are sent again by the next flush.
+ *
+ * @param scr Screen buffer descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t hd44780_screen_flush(hd44780_screen_t *scr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,2 +1,2 @@
 COMPONENT_ADD_INCLUDEDIRS = .
-COMPONENT_DEPENDS = i2cdev log
+COMPONENT_DEPENDS = i2cdev log esp_timer framebuffer
@@ -215,3 +215,17 @@ esp_err_t ht16k33_ram_write(i2c_dev_t* dev, uint8_t* data)
 
     return ESP_OK;
 }
+
+esp_err_t ht16k33_ram_write_range(i2c_dev_t* dev, uint8_t offset, const uint8_t* data, size_t len)
+{
+    CHECK_ARG(dev && data && len && offset + len <= HT16K33_RAM_SIZE_BYTES);
+
+    // Pointer set command followed by values, address is auto-incremented.
+    uint8_t reg = HT16K33_CMD_RAM_SET_POINTER << 4 | offset;
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, i2c_dev_write(dev, &reg, 1, data, len));
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return ESP_OK;
+}
@@ -115,6 +115,17 @@ esp_err_t ht16k33_display_setup(i2c_dev_t *dev, uint8_t on_flag,
  */
 esp_err_t ht16k33_ram_write(i2c_dev_t *dev, uint8_t *data);
 
+/**
+ * @brief Write part of RAM in one auto-increment burst.
+ *
+ * @param dev I2C device descriptor
+ * @param offset First RAM address, 0-15.
+ * @param data Bytes to write.
+ * @param len Number of bytes, offset + len must not exceed HT16K33_RAM_SIZE_BYTES.
+ * @return ESP_OK to indicate success
+ */
+esp_err_t ht16k33_ram_write_range(i2c_dev_t *dev, uint8_t offset, const uint8_t *data, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2022 Timofei Korostelev <timofei_public@dranik.dev>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "ht16k33_fb.h"
+
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+static const char* TAG = "ht16k33_fb";
+
+#define WORKER_STACK_SIZE 2048
+
+#define CHECK_ARG(VAL)                  \
+    do {                                \
+        if (!(VAL))                     \
+            return ESP_ERR_INVALID_ARG; \
+    } while (0);
+
+static void build_ram(framebuffer_t* fb, ht16k33_tile_t* tile)
+{
+    for (size_t y = 0; y < 8; y++) {
+        const rgb_t* row = fb->data + FB_OFFSET(fb, tile->x, tile->y + y);
+        for (size_t b = 0; b < 2; b++) {
+            uint8_t bits = 0;
+            for (size_t x = 0; x < 8 && b * 8 + x < tile->width; x++)
+                if (rgb_luma(row[b * 8 + x]) >= HT16K33_FB_THRESHOLD)
+                    bits |= 1 << x;
+            tile->ram[y * 2 + b] = bits;
+        }
+    }
+}
+
+static esp_err_t update_tile(ht16k33_fb_t* ctx, ht16k33_tile_t* tile, uint32_t* bytes)
+{
+    if (!tile->valid || tile->brightness != ctx->brightness) {
+        esp_err_t res = ht16k33_set_brightness(tile->dev, ctx->brightness);
+        if (res != ESP_OK)
+            return res;
+        tile->brightness = ctx->brightness;
+    }
+
+    size_t first = 0, last = HT16K33_RAM_SIZE_BYTES - 1;
+    if (tile->valid) {
+        while (first < HT16K33_RAM_SIZE_BYTES && tile->ram[first] == tile->shown[first])
+            first++;
+        if (first == HT16K33_RAM_SIZE_BYTES)
+            return ESP_OK;
+        while (tile->ram[last] == tile->shown[last])
+            last--;
+    }
+
+    size_t len = last - first + 1;
+    // Chip state is unknown after failure, resend whole RAM next time.
+    tile->valid = false;
+    esp_err_t res = ht16k33_ram_write_range(tile->dev, first, tile->ram + first, len);
+    if (res != ESP_OK)
+        return res;
+    memcpy(tile->shown + first, tile->ram + first, len);
+    tile->valid = true;
+    *bytes += len;
+
+    return ESP_OK;
+}
+
+static uint32_t update_tiles(ht16k33_fb_t* ctx, ht16k33_fb_worker_t* worker)
+{
+    uint32_t bytes = 0;
+    for (size_t i = 0; i < ctx->count; i++) {
+        ht16k33_tile_t* tile = ctx->tiles + i;
+        if (!worker || tile->dev->port == worker->port)
+            tile->res = update_tile(ctx, tile, &bytes);
+    }
+    return bytes;
+}
+
+static void worker_task(void* arg)
+{
+    ht16k33_fb_worker_t* worker = (ht16k33_fb_worker_t*)arg;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        worker->bytes = update_tiles(worker->ctx, worker);
+        xSemaphoreGive(worker->ctx->done);
+    }
+}
+
+esp_err_t ht16k33_fb_init(ht16k33_fb_t* ctx, ht16k33_tile_t* tiles, size_t count, UBaseType_t priority)
+{
+    CHECK_ARG(ctx && tiles && count);
+
+    memset(ctx, 0, sizeof(ht16k33_fb_t));
+    ctx->tiles = tiles;
+    ctx->count = count;
+    ctx->brightness = HT16K33_MAX_BRIGHTNESS / 2;
+
+    for (size_t i = 0; i < count; i++) {
+        ht16k33_tile_t* tile = tiles + i;
+        CHECK_ARG(tile->dev && (tile->width == 8 || tile->width == 16));
+        memset(tile->ram, 0, sizeof(tile->ram));
+        memset(tile->shown, 0, sizeof(tile->shown));
+        tile->valid = false;
+        tile->res = ESP_OK;
+    }
+
+    if (!priority)
+        return ESP_OK;
+
+    ctx->done = xSemaphoreCreateCounting(I2C_NUM_MAX, 0);
+    if (!ctx->done)
+        return ESP_ERR_NO_MEM;
+
+    for (size_t i = 0; i < count; i++) {
+        i2c_port_t port = tiles[i].dev->port;
+        size_t w = 0;
+        while (w < ctx->worker_count && ctx->workers[w].port != port)
+            w++;
+        if (w < ctx->worker_count)
+            continue;
+
+        ht16k33_fb_worker_t* worker = ctx->workers + ctx->worker_count;
+        worker->ctx = ctx;
+        worker->port = port;
+        if (xTaskCreate(worker_task, TAG, WORKER_STACK_SIZE, worker, priority, &worker->task) != pdPASS) {
+            ht16k33_fb_free(ctx);
+            return ESP_ERR_NO_MEM;
+        }
+        ctx->worker_count++;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ht16k33_fb_free(ht16k33_fb_t* ctx)
+{
+    CHECK_ARG(ctx);
+
+    for (size_t i = 0; i < ctx->worker_count; i++) {
+        vTaskDelete(ctx->workers[i].task);
+        ctx->workers[i].task = NULL;
+    }
+    ctx->worker_count = 0;
+
+    if (ctx->done) {
+        vSemaphoreDelete(ctx->done);
+        ctx->done = NULL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ht16k33_fb_set_brightness(ht16k33_fb_t* ctx, uint8_t brightness)
+{
+    CHECK_ARG(ctx && brightness <= HT16K33_MAX_BRIGHTNESS);
+
+    ctx->brightness = brightness;
+
+    return ESP_OK;
+}
+
+esp_err_t ht16k33_fb_render(framebuffer_t* fb, void* arg)
+{
+    ht16k33_fb_t* ctx = (ht16k33_fb_t*)arg;
+    CHECK_ARG(fb && fb->data && ctx);
+
+    int64_t start = esp_timer_get_time();
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        ht16k33_tile_t* tile = ctx->tiles + i;
+        CHECK_ARG(tile->x + tile->width <= fb->width && tile->y + 8 <= fb->height);
+        build_ram(fb, tile);
+    }
+
+    if (ctx->worker_count) {
+        for (size_t i = 0; i < ctx->worker_count; i++)
+            xTaskNotifyGive(ctx->workers[i].task);
+        for (size_t i = 0; i < ctx->worker_count; i++)
+            xSemaphoreTake(ctx->done, portMAX_DELAY);
+        ctx->bytes = 0;
+        for (size_t i = 0; i < ctx->worker_count; i++)
+            ctx->bytes += ctx->workers[i].bytes;
+    } else
+        ctx->bytes = update_tiles(ctx, NULL);
+
+    ctx->render_us = esp_timer_get_time() - start;
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        if (ctx->tiles[i].res != ESP_OK) {
+            ESP_LOGE(TAG, "Error updating tile %d: %d (%s)", (int)i, ctx->tiles[i].res, esp_err_to_name(ctx->tiles[i].res));
+            return ctx->tiles[i].res;
+        }
+    }
+
+    return ESP_OK;
+}
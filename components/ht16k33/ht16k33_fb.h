@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2022 Timofei Korostelev <timofei_public@dranik.dev>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * @file ht16k33_fb.h
+ * @defgroup ht16k33_fb ht16k33_fb
+ * @{
+ *
+ * Framebuffer renderer for HT16K33 driven 8x8 and 16x8 LED matrix tiles.
+ *
+ * Every tile keeps a copy of the chip RAM, only the changed byte span
+ * is written on each frame. Tiles on different I2C ports can be
+ * updated in parallel by per-port worker tasks.
+ */
+
+#if !defined(__HT16K33_FB_H__)
+#define __HT16K33_FB_H__
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <framebuffer.h>
+#include "ht16k33.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Minimal luma of framebuffer pixel to light the LED
+ */
+#define HT16K33_FB_THRESHOLD 128
+
+/**
+ * Tile descriptor
+ */
+typedef struct {
+    i2c_dev_t *dev;    //!< Initialized HT16K33 device
+    size_t x;          //!< Left column of the tile in framebuffer
+    size_t y;          //!< Top row of the tile in framebuffer
+    uint8_t width;     //!< Tile width, 8 or 16 pixels. Height is always 8 pixels
+    uint8_t ram[HT16K33_RAM_SIZE_BYTES];   //!< RAM contents to display
+    uint8_t shown[HT16K33_RAM_SIZE_BYTES]; //!< RAM contents on chip
+    uint8_t brightness; //!< Brightness set on chip
+    bool valid;        //!< false if chip state is unknown
+    esp_err_t res;     //!< Result of the last tile update
+} ht16k33_tile_t;
+
+typedef struct ht16k33_fb ht16k33_fb_t;
+
+/**
+ * Per-port worker descriptor
+ */
+typedef struct {
+    ht16k33_fb_t *ctx; //!< Renderer
+    i2c_port_t port;   //!< I2C port served by worker
+    TaskHandle_t task; //!< Worker task
+    uint32_t bytes;    //!< RAM bytes sent by worker during the last frame
+} ht16k33_fb_worker_t;
+
+/**
+ * Renderer descriptor
+ */
+struct ht16k33_fb {
+    ht16k33_tile_t *tiles; //!< Array of tiles
+    size_t count;          //!< Number of tiles
+    uint8_t brightness;    //!< Brightness to set on all tiles, 0-15
+    ht16k33_fb_worker_t workers[I2C_NUM_MAX]; //!< Workers, one per used port
+    size_t worker_count;   //!< Number of workers, 0 for sequential update
+    SemaphoreHandle_t done; //!< Given by workers when tiles are updated
+    uint32_t bytes;        //!< RAM bytes sent during the last frame
+    uint32_t render_us;    //!< Duration of the last render, us
+};
+
+/**
+ * @brief Initialize renderer
+ *
+ * Tiles must have `dev`, `x`, `y` and `width` filled, all other fields
+ * are reset. Devices must be initialized by ::ht16k33_init() and
+ * turned on by ::ht16k33_display_setup().
+ *
+ * @param ctx Renderer descriptor
+ * @param tiles Array of tiles
+ * @param count Number of tiles
+ * @param priority Priority of per-port worker tasks. 0 to update tiles
+ *                 sequentially in the rendering task
+ * @return ESP_OK to indicate success
+ */
+esp_err_t ht16k33_fb_init(ht16k33_fb_t *ctx, ht16k33_tile_t *tiles, size_t count, UBaseType_t priority);
+
+/**
+ * @brief Stop worker tasks
+ *
+ * @param ctx Renderer descriptor
+ * @return ESP_OK to indicate success
+ */
+esp_err_t ht16k33_fb_free(ht16k33_fb_t *ctx);
+
+/**
+ * @brief Set brightness of all tiles
+ *
+ * Brightness is sent to the chips on the next render and only if changed,
+ * so it can be animated frame by frame.
+ *
+ * @param ctx Renderer descriptor
+ * @param brightness Brightness, 0-15
+ * @return ESP_OK to indicate success
+ */
+esp_err_t ht16k33_fb_set_brightness(ht16k33_fb_t *ctx, uint8_t brightness);
+
+/**
+ * @brief Framebuffer render callback for HT16K33 tiles
+ *
+ * Pixel (x, y) of a tile is bit x % 8 of RAM byte y * 2 + x / 8.
+ * Pixels are lit if their luma is not less than ::HT16K33_FB_THRESHOLD.
+ * Only the span between the first and the last changed RAM byte is sent.
+ *
+ * Pass pointer to initialized ::ht16k33_fb_t as render context.
+ *
+ * @param fb Framebuffer descriptor
+ * @param arg Renderer descriptor
+ * @return ESP_OK to indicate success
+ */
+esp_err_t ht16k33_fb_render(framebuffer_t *fb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif // __HT16K33_FB_H__
@@ -2,6 +2,7 @@ COMPONENT_ADD_INCLUDEDIRS = .
 
 ifdef CONFIG_IDF_TARGET_ESP8266
 COMPONENT_DEPENDS = esp8266 freertos esp_idf_lib_helpers
+COMPONENT_OBJEXCLUDE = hx711_spi.o
 else
-COMPONENT_DEPENDS = driver freertos esp_idf_lib_helpers
+COMPONENT_DEPENDS = driver freertos log esp_idf_lib_helpers
 endif
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2019 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file hx711_spi.c
+ *
+ * SPI-clocked streaming backend for HX711
+ *
+ * Copyright (c) 2019 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_rom_gpio.h>
+#include <soc/spi_periph.h>
+#include <soc/gpio_sig_map.h>
+#include <esp_idf_lib_helpers.h>
+#include "hx711_spi.h"
+
+static const char *TAG = "hx711_spi";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define TASK_STACK_SIZE 2048
+// PD_SCK high and low times must be at least 0.2 us each
+#define MAX_CLOCK_SPEED 2500000
+
+// every PD_SCK pulse is two SPI bits: high, then low
+#define SCK_PATTERN 0xaa
+#define DATA_BITS 24
+
+static SemaphoreHandle_t locks[SPI_HOST_MAX] = { 0 };
+
+static inline size_t ring_count(hx711_spi_channel_t *ch)
+{
+    return __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+}
+
+static void ring_push(hx711_spi_channel_t *ch, int32_t value)
+{
+    size_t head = ch->head;
+    if (head - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE) >= ch->size)
+    {
+        ch->overruns++;
+        return;
+    }
+    ch->buf[head & (ch->size - 1)] = value;
+    __atomic_store_n(&ch->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void IRAM_ATTR dout_isr(void *arg)
+{
+    hx711_spi_channel_t *ch = (hx711_spi_channel_t *)arg;
+
+    // DOUT toggles while data is shifted out, ignore these edges
+    if (ch->busy)
+        return;
+    ch->busy = true;
+
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(ch->bus->task, BIT(ch->index), eSetBits, &woken);
+    if (woken == pdTRUE)
+        portYIELD_FROM_ISR();
+}
+
+static void route(hx711_spi_bus_t *bus, hx711_spi_channel_t *ch)
+{
+    esp_rom_gpio_connect_in_signal(ch->dev.dout, spi_periph_signal[bus->host].spiq_in, false);
+    esp_rom_gpio_connect_out_signal(ch->dev.pd_sck, spi_periph_signal[bus->host].spid_out, false, false);
+}
+
+static void unroute(hx711_spi_channel_t *ch)
+{
+    // PD_SCK must stay low between readouts, otherwise device powers down
+    gpio_set_level(ch->dev.pd_sck, 0);
+    esp_rom_gpio_connect_out_signal(ch->dev.pd_sck, SIG_GPIO_OUT_IDX, false, false);
+}
+
+static int32_t decode(const uint8_t *rx)
+{
+    // DOUT changes up to 0.1 us after PD_SCK rising edge and holds until
+    // the next one. SPI samples in the middle of a bit, so HX711 bit N is
+    // taken from SPI bit 2N + 1 (low phase of PD_SCK), 1.5 SPI bits after
+    // the edge: at least 0.6 us, well past the 0.1 us settling time
+    uint32_t raw = 0;
+    for (size_t i = 0; i < DATA_BITS; i++)
+    {
+        size_t bit = i * 2 + 1;
+        raw = (raw << 1) | ((rx[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    if (raw & 0x800000)
+        raw |= 0xff000000;
+    return (int32_t)raw;
+}
+
+static esp_err_t read_channel(hx711_spi_bus_t *bus, hx711_spi_channel_t *ch)
+{
+    // 24 data pulses + 1..3 pulses selecting gain and channel of next conversion
+    spi_transaction_t t = {
+        .length = (DATA_BITS + ch->dev.gain + 1) * 2,
+        .tx_buffer = ch->tx,
+        .rx_buffer = ch->rx,
+    };
+
+    route(bus, ch);
+    esp_err_t res = spi_device_polling_transmit(bus->spi, &t);
+    unroute(ch);
+    if (res != ESP_OK)
+        return res;
+
+    ring_push(ch, decode(ch->rx));
+
+    return ESP_OK;
+}
+
+static void worker(void *arg)
+{
+    hx711_spi_bus_t *bus = (hx711_spi_bus_t *)arg;
+    SemaphoreHandle_t lock = locks[bus->host];
+    uint32_t pending = 0;
+
+    while (true)
+    {
+        uint32_t bits;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        pending |= bits;
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        while (pending)
+        {
+            uint8_t i = __builtin_ctz(pending);
+            pending &= pending - 1;
+
+            hx711_spi_channel_t *ch = bus->channels[i];
+            if (!ch)
+                continue;
+
+            gpio_intr_disable(ch->dev.dout);
+            // stale edge latched while interrupt was disabled, data is not ready
+            if (!gpio_get_level(ch->dev.dout))
+            {
+                esp_err_t res = read_channel(bus, ch);
+                if (res != ESP_OK)
+                    ESP_LOGE(TAG, "[%d] Error reading data: %d (%s)", i, res, esp_err_to_name(res));
+            }
+            ch->busy = false;
+            gpio_intr_enable(ch->dev.dout);
+
+            // next conversion could complete while interrupt was disabled
+            if (!gpio_get_level(ch->dev.dout) && !ch->busy)
+            {
+                ch->busy = true;
+                pending |= BIT(i);
+            }
+        }
+        xSemaphoreGive(lock);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t hx711_spi_bus_init(hx711_spi_bus_t *bus, spi_host_device_t host, int clock_speed_hz, UBaseType_t priority)
+{
+    CHECK_ARG(bus && host < SPI_HOST_MAX && clock_speed_hz > 0 && clock_speed_hz <= MAX_CLOCK_SPEED);
+
+    if (locks[host])
+    {
+        ESP_LOGE(TAG, "SPI host %d already in use", host);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t res = gpio_install_isr_service(0);
+    if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+        return res;
+
+    memset(bus, 0, sizeof(hx711_spi_bus_t));
+    bus->host = host;
+
+    spi_bus_config_t bus_cfg = {
+        .mosi_io_num = -1,
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .flags = SPICOMMON_BUSFLAG_MASTER,
+    };
+    CHECK(spi_bus_initialize(host, &bus_cfg, SPI_DMA_DISABLED));
+
+    spi_device_interface_config_t dev_cfg = {
+        .mode = 0,
+        .clock_speed_hz = clock_speed_hz,
+        .spics_io_num = -1,
+        .queue_size = 1,
+    };
+    res = spi_bus_add_device(host, &dev_cfg, &bus->spi);
+    if (res != ESP_OK)
+        goto fail_bus;
+
+    locks[host] = xSemaphoreCreateMutex();
+    if (!locks[host])
+    {
+        res = ESP_ERR_NO_MEM;
+        goto fail_dev;
+    }
+
+    if (xTaskCreate(worker, TAG, TASK_STACK_SIZE, bus, priority, &bus->task) != pdPASS)
+    {
+        res = ESP_ERR_NO_MEM;
+        goto fail_lock;
+    }
+
+    ESP_LOGD(TAG, "Bus initialized on SPI host %d", host);
+
+    return ESP_OK;
+
+fail_lock:
+    vSemaphoreDelete(locks[host]);
+    locks[host] = NULL;
+fail_dev:
+    spi_bus_remove_device(bus->spi);
+fail_bus:
+    spi_bus_free(host);
+    return res;
+}
+
+esp_err_t hx711_spi_bus_done(hx711_spi_bus_t *bus)
+{
+    CHECK_ARG(bus && bus->task);
+
+    for (size_t i = 0; i < HX711_SPI_MAX_CHANNELS; i++)
+        if (bus->channels[i])
+            return ESP_ERR_INVALID_STATE;
+
+    SemaphoreHandle_t lock = locks[bus->host];
+    xSemaphoreTake(lock, portMAX_DELAY);
+    vTaskDelete(bus->task);
+    bus->task = NULL;
+    locks[bus->host] = NULL;
+    xSemaphoreGive(lock);
+    vSemaphoreDelete(lock);
+
+    CHECK(spi_bus_remove_device(bus->spi));
+    CHECK(spi_bus_free(bus->host));
+
+    ESP_LOGD(TAG, "Bus on SPI host %d freed", bus->host);
+
+    return ESP_OK;
+}
+
+esp_err_t hx711_spi_add(hx711_spi_bus_t *bus, hx711_spi_channel_t *ch, gpio_num_t dout, gpio_num_t pd_sck,
+        hx711_gain_t gain, size_t buf_size)
+{
+    CHECK_ARG(bus && bus->task && ch && gain <= HX711_GAIN_A_64 && buf_size && !(buf_size & (buf_size - 1)));
+
+    uint8_t index = HX711_SPI_MAX_CHANNELS;
+    for (uint8_t i = 0; i < HX711_SPI_MAX_CHANNELS; i++)
+        if (!bus->channels[i])
+        {
+            index = i;
+            break;
+        }
+    if (index == HX711_SPI_MAX_CHANNELS)
+        return ESP_ERR_NO_MEM;
+
+    memset(ch, 0, sizeof(hx711_spi_channel_t));
+    ch->dev.dout = dout;
+    ch->dev.pd_sck = pd_sck;
+    ch->dev.gain = gain;
+    ch->bus = bus;
+    ch->index = index;
+    ch->size = buf_size;
+    memset(ch->tx, SCK_PATTERN, sizeof(ch->tx));
+
+    ch->buf = calloc(buf_size, sizeof(int32_t));
+    if (!ch->buf)
+        return ESP_ERR_NO_MEM;
+
+    esp_err_t res;
+    gpio_config_t conf = {
+        .pin_bit_mask = BIT64(dout),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = 0,
+        .pull_down_en = 0,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    if ((res = gpio_config(&conf)) != ESP_OK)
+        goto fail;
+    gpio_intr_disable(dout);
+
+    conf.pin_bit_mask = BIT64(pd_sck);
+    conf.mode = GPIO_MODE_OUTPUT;
+    conf.intr_type = GPIO_INTR_DISABLE;
+    if ((res = gpio_config(&conf)) != ESP_OK)
+        goto fail;
+    // power up
+    gpio_set_level(pd_sck, 0);
+
+    if ((res = gpio_isr_handler_add(dout, dout_isr, ch)) != ESP_OK)
+        goto fail;
+
+    xSemaphoreTake(locks[bus->host], portMAX_DELAY);
+    bus->channels[index] = ch;
+    xSemaphoreGive(locks[bus->host]);
+
+    // conversion may be ready already, then there will be no edge
+    if (!gpio_get_level(dout))
+    {
+        ch->busy = true;
+        xTaskNotify(bus->task, BIT(index), eSetBits);
+    }
+    gpio_intr_enable(dout);
+
+    ESP_LOGD(TAG, "[%d] Channel added, DOUT=%d, PD_SCK=%d", index, dout, pd_sck);
+
+    return ESP_OK;
+
+fail:
+    free(ch->buf);
+    ch->buf = NULL;
+    return res;
+}
+
+esp_err_t hx711_spi_remove(hx711_spi_channel_t *ch)
+{
+    CHECK_ARG(ch && ch->bus && ch->buf);
+
+    hx711_spi_bus_t *bus = ch->bus;
+
+    gpio_intr_disable(ch->dev.dout);
+    CHECK(gpio_isr_handler_remove(ch->dev.dout));
+
+    xSemaphoreTake(locks[bus->host], portMAX_DELAY);
+    bus->channels[ch->index] = NULL;
+    xSemaphoreGive(locks[bus->host]);
+
+    // power down
+    gpio_set_level(ch->dev.pd_sck, 1);
+
+    free(ch->buf);
+    ch->buf = NULL;
+    ch->bus = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t hx711_spi_set_gain(hx711_spi_channel_t *ch, hx711_gain_t gain)
+{
+    CHECK_ARG(ch && gain <= HX711_GAIN_A_64);
+
+    ch->dev.gain = gain;
+
+    return ESP_OK;
+}
+
+esp_err_t hx711_spi_available(hx711_spi_channel_t *ch, size_t *count)
+{
+    CHECK_ARG(ch && ch->buf && count);
+
+    *count = ring_count(ch);
+
+    return ESP_OK;
+}
+
+esp_err_t hx711_spi_read(hx711_spi_channel_t *ch, int32_t *data, size_t len, size_t *read)
+{
+    CHECK_ARG(ch && ch->buf && data && read);
+
+    size_t tail = ch->tail;
+    size_t n = ring_count(ch);
+    if (n > len)
+        n = len;
+
+    for (size_t i = 0; i < n; i++)
+        data[i] = ch->buf[(tail + i) & (ch->size - 1)];
+    __atomic_store_n(&ch->tail, tail + n, __ATOMIC_RELEASE);
+
+    *read = n;
+
+    return ESP_OK;
+}
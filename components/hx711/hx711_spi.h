@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2019 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file hx711_spi.h
+ * @defgroup hx711_spi hx711_spi
+ * @{
+ *
+ * SPI-clocked streaming backend for HX711
+ *
+ * PD_SCK is generated on the SPI MOSI line (each HX711 clock is two SPI
+ * bits, `10`), DOUT is sampled on the SPI MISO line in the middle of the
+ * low phase, well after it settles. Readout is started from the DOUT
+ * falling edge interrupt by a single worker task per SPI host, so no
+ * critical sections or busy-waiting are involved. SPI signals are routed
+ * to the pins of each channel through the GPIO matrix right before its
+ * readout, which allows several scales to share one SPI host.
+ *
+ * Copyright (c) 2019 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __HX711_SPI_H__
+#define __HX711_SPI_H__
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/spi_master.h>
+#include "hx711.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Maximum number of channels per SPI host
+ */
+#define HX711_SPI_MAX_CHANNELS 16
+
+/**
+ * Default SPI clock, Hz. One HX711 PD_SCK period takes two SPI bits,
+ * so the default gives 1 us high / 1 us low.
+ */
+#define HX711_SPI_DEFAULT_CLOCK 1000000
+
+typedef struct hx711_spi_bus hx711_spi_bus_t;
+
+/**
+ * Channel (single HX711) descriptor
+ */
+typedef struct
+{
+    hx711_t dev;                //!< Pins and gain of the device
+    hx711_spi_bus_t *bus;       //!< Bus the channel is attached to
+    uint8_t index;              //!< Index of the channel on the bus
+
+    int32_t *buf;               //!< Ring buffer of raw samples
+    size_t size;                //!< Ring buffer size, power of 2
+    volatile size_t head;       //!< Write position, updated by worker only
+    volatile size_t tail;       //!< Read position, updated by reader only
+    volatile uint32_t overruns; //!< Number of samples dropped because of full buffer
+    volatile bool busy;         //!< Readout is pending or in progress
+
+    WORD_ALIGNED_ATTR uint8_t tx[8];
+    WORD_ALIGNED_ATTR uint8_t rx[8];
+} hx711_spi_channel_t;
+
+/**
+ * SPI host descriptor
+ */
+struct hx711_spi_bus
+{
+    spi_host_device_t host;     //!< SPI host
+    spi_device_handle_t spi;    //!< SPI device handle
+    TaskHandle_t task;          //!< Worker task
+    hx711_spi_channel_t *channels[HX711_SPI_MAX_CHANNELS]; //!< Attached channels
+};
+
+/**
+ * @brief Initialize SPI host and start worker task
+ *
+ * SPI bus is initialized by this function without any pins, all
+ * signal routing is done per channel.
+ *
+ * @param bus Bus descriptor
+ * @param host SPI host to use
+ * @param clock_speed_hz SPI clock, Hz. PD_SCK frequency is half of it,
+ *                       must not exceed 2.5 MHz
+ * @param priority Worker task priority
+ * @return `ESP_OK` on success
+ */
+esp_err_t hx711_spi_bus_init(hx711_spi_bus_t *bus, spi_host_device_t host, int clock_speed_hz, UBaseType_t priority);
+
+/**
+ * @brief Stop worker task and free SPI host
+ *
+ * All channels must be removed before calling this function.
+ *
+ * @param bus Bus descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t hx711_spi_bus_done(hx711_spi_bus_t *bus);
+
+/**
+ * @brief Attach HX711 to the bus and start streaming
+ *
+ * Channel is powered up and starts streaming samples into the ring
+ * buffer right away. First sample after this call is measured with
+ * the gain the device had before.
+ *
+ * @param bus Bus descriptor
+ * @param ch Channel descriptor
+ * @param dout DOUT pin
+ * @param pd_sck PD_SCK pin
+ * @param gain Gain and channel
+ * @param buf_size Ring buffer size in samples, must be a power of 2
+ * @return `ESP_OK` on success
+ */
+esp_err_t hx711_spi_add(hx711_spi_bus_t *bus, hx711_spi_channel_t *ch, gpio_num_t dout, gpio_num_t pd_sck,
+        hx711_gain_t gain, size_t buf_size);
+
+/**
+ * @brief Detach HX711 from the bus and free ring buffer
+ *
+ * Device is left powered down.
+ *
+ * @param ch Channel descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t hx711_spi_remove(hx711_spi_channel_t *ch);
+
+/**
+ * @brief Change gain and channel
+ *
+ * New gain is applied to the conversion following the next readout.
+ *
+ * @param ch Channel descriptor
+ * @param gain Gain and channel
+ * @return `ESP_OK` on success
+ */
+esp_err_t hx711_spi_set_gain(hx711_spi_channel_t *ch, hx711_gain_t gain);
+
+/**
+ * @brief Get number of samples waiting in the ring buffer
+ *
+ * @param ch Channel descriptor
+ * @param[out] count Number of samples
+ * @return `ESP_OK` on success
+ */
+esp_err_t hx711_spi_available(hx711_spi_channel_t *ch, size_t *count);
+
+/**
+ * @brief Read raw samples from the ring buffer
+ *
+ * Function does not block. Only one task may read a channel.
+ *
+ * @param ch Channel descriptor
+ * @param[out] data Buffer for samples
+ * @param len Buffer size in samples
+ * @param[out] read Number of samples actually read
+ * @return `ESP_OK` on success
+ */
+esp_err_t hx711_spi_read(hx711_spi_channel_t *ch, int32_t *data, size_t len, size_t *read);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __HX711_SPI_H__ */
@@ -36,8 +36,12 @@
  */
 #include "impulse_sensor.h"
 
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <driver/gpio.h>
 #include <esp_timer.h>
 #include <esp_idf_lib_helpers.h>
@@ -56,12 +60,16 @@
 
 #if HELPER_TARGET_IS_ESP32
 static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-#define PORT_ENTER_CRITICAL() portENTER_CRITICAL(&mux)
-#define PORT_EXIT_CRITICAL()  portEXIT_CRITICAL(&mux)
+#define PORT_ENTER_CRITICAL()     portENTER_CRITICAL(&mux)
+#define PORT_EXIT_CRITICAL()      portEXIT_CRITICAL(&mux)
+#define PORT_ENTER_CRITICAL_ISR() portENTER_CRITICAL_ISR(&mux)
+#define PORT_EXIT_CRITICAL_ISR()  portEXIT_CRITICAL_ISR(&mux)
 
 #elif HELPER_TARGET_IS_ESP8266
-#define PORT_ENTER_CRITICAL() portENTER_CRITICAL()
-#define PORT_EXIT_CRITICAL()  portEXIT_CRITICAL()
+#define PORT_ENTER_CRITICAL()     portENTER_CRITICAL()
+#define PORT_EXIT_CRITICAL()      portEXIT_CRITICAL()
+#define PORT_ENTER_CRITICAL_ISR() portENTER_CRITICAL()
+#define PORT_EXIT_CRITICAL_ISR()  portEXIT_CRITICAL()
 
 #else
 #error cannot identify the target
@@ -75,40 +83,98 @@ static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
     }                                                                                                                                                                                                  \
     while (0)
 
-typedef struct
+#define PCNT_HIGH_LIMIT SHRT_MAX
+
+typedef struct imp_sensor_priv imp_sensor_priv_t;
+
+struct imp_sensor_priv
 {
+    imp_sensor_priv_t *next;  //!< next sensor served by the same timer
     gpio_num_t input_pin;     //!< GPIO input pin
     float sf;                 //!< scale factor
-    int pps;                  //!< measured pulses count per second
-    esp_timer_handle_t timer; //!< periodic timer to reset pps count
+    uint32_t period_ms;       //!< measurement period
+    bool edge_timestamps;     //!< GPIO interrupt on every edge is enabled
 
 #if ESP_PCNT_SUPPORTED
     pcnt_unit_handle_t pcnt_unit;  //!< hardware pulse counter
     pcnt_channel_handle_t pcnt_ch; //!< hardware pulse counter channel
-#else
-    int pulse_count; //!< pulses counter
 #endif
-} imp_sensor_priv_t;
+    volatile uint32_t edges;       //!< edges counted by GPIO interrupt
+    volatile int64_t last_edge;    //!< timestamp of the last edge, us
+
+    /* service timer state */
+    uint64_t total;           //!< total pulses at last update
+    int64_t last_update;      //!< time of last update, us
+    uint32_t prev_edges;      //!< edges at last update
+    int64_t prev_edge;        //!< timestamp of the last edge at last update, us
+    float last_rate;          //!< rate at last update
+    float rates[IMP_SENSOR_MAX_AVG_WINDOW]; //!< last rates for rolling average
+    uint32_t window;          //!< rolling average window
+    uint32_t rate_pos;        //!< next position in rates
+    uint32_t rate_len;        //!< number of valid rates
+
+    /* published snapshot, seqlock protected */
+    volatile uint32_t seq;
+    imp_sensor_snapshot_t snapshot;
+};
+
+static imp_sensor_priv_t *sensors = NULL;
+static esp_timer_handle_t service_timer = NULL;
+static uint32_t service_period_ms = 0;
+static SemaphoreHandle_t service_lock = NULL;
+
+static void IRAM_ATTR gpio_isr_handler(void *arg)
+{
+    imp_sensor_priv_t *priv = (imp_sensor_priv_t *)arg;
+    int64_t now = esp_timer_get_time();
+
+    PORT_ENTER_CRITICAL_ISR();
+    priv->edges++;
+    priv->last_edge = now;
+    PORT_EXIT_CRITICAL_ISR();
+}
+
+static esp_err_t edge_isr_init(imp_sensor_priv_t *priv)
+{
+    /* enable interrupts */
+    esp_err_t rc = gpio_install_isr_service(0);
+    if (rc != ESP_OK && rc != ESP_ERR_INVALID_STATE)
+    {
+        return rc;
+    }
+    /* setup GPIO */
+    gpio_config_t io_conf = { .intr_type = GPIO_INTR_POSEDGE, .pin_bit_mask = (1ULL << priv->input_pin), .mode = GPIO_MODE_INPUT, .pull_up_en = GPIO_PULLUP_ENABLE };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(priv->input_pin, gpio_isr_handler, priv));
+    return ESP_OK;
+}
 
 #if ESP_PCNT_SUPPORTED
 
 static esp_err_t pulse_counter_init(imp_sensor_priv_t *priv)
 {
-    pcnt_unit_config_t unit_config = { .high_limit = SHRT_MAX, .low_limit = -1 };
+    /* driver keeps the count accumulated over high limit resets */
+    pcnt_unit_config_t unit_config = { .high_limit = PCNT_HIGH_LIMIT, .low_limit = -1, .flags.accum_count = true };
 
     pcnt_chan_config_t ch_config = { .edge_gpio_num = priv->input_pin, .level_gpio_num = -1 };
 
     ESP_ERROR_CHECK(pcnt_new_unit(&unit_config, &priv->pcnt_unit));
     ESP_ERROR_CHECK(pcnt_new_channel(priv->pcnt_unit, &ch_config, &priv->pcnt_ch));
     ESP_ERROR_CHECK(pcnt_channel_set_edge_action(priv->pcnt_ch, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(priv->pcnt_unit, PCNT_HIGH_LIMIT));
     ESP_ERROR_CHECK(pcnt_unit_enable(priv->pcnt_unit));
     ESP_ERROR_CHECK(pcnt_unit_clear_count(priv->pcnt_unit));
     ESP_ERROR_CHECK(pcnt_unit_start(priv->pcnt_unit));
+
+    if (priv->edge_timestamps)
+        return edge_isr_init(priv);
     return ESP_OK;
 }
 
 static esp_err_t pulse_counter_deinit(imp_sensor_priv_t *priv)
 {
+    if (priv->edge_timestamps)
+        ESP_ERROR_CHECK(gpio_isr_handler_remove(priv->input_pin));
     ESP_ERROR_CHECK(pcnt_unit_stop(priv->pcnt_unit));
     ESP_ERROR_CHECK(pcnt_unit_disable(priv->pcnt_unit));
     ESP_ERROR_CHECK(pcnt_del_channel(priv->pcnt_ch));
@@ -116,35 +182,21 @@ static esp_err_t pulse_counter_deinit(imp_sensor_priv_t *priv)
     return ESP_OK;
 }
 
-static void timer_event_callback(void *arg)
+static uint64_t pulse_counter_total(imp_sensor_priv_t *priv)
 {
-    imp_sensor_priv_t *priv = (imp_sensor_priv_t *)arg;
+    int count = 0;
+    pcnt_unit_get_count(priv->pcnt_unit, &count);
 
-    pcnt_unit_get_count(priv->pcnt_unit, &priv->pps);
-    pcnt_unit_clear_count(priv->pcnt_unit);
+    /* accumulated count is 32-bit, unsigned difference survives its wrap */
+    return priv->total + (uint32_t)((uint32_t)count - (uint32_t)priv->total);
 }
 
 #else
 
-static void IRAM_ATTR gpio_isr_handler(void *arg)
-{
-    imp_sensor_priv_t *priv = (imp_sensor_priv_t *)arg;
-    priv->pulse_count++;
-}
-
 static esp_err_t pulse_counter_init(imp_sensor_priv_t *priv)
 {
-    /* enable interrupts */
-    esp_err_t rc = gpio_install_isr_service(0);
-    if (rc != ESP_OK && rc != ESP_ERR_INVALID_STATE)
-    {
-        return rc;
-    }
-    /* setup GPIO */
-    gpio_config_t io_conf = { .intr_type = GPIO_INTR_POSEDGE, .pin_bit_mask = (1 << priv->input_pin), .mode = GPIO_MODE_INPUT, .pull_up_en = GPIO_PULLUP_ENABLE };
-    ESP_ERROR_CHECK(gpio_config(&io_conf));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(priv->input_pin, gpio_isr_handler, priv));
-    return ESP_OK;
+    priv->edge_timestamps = true;
+    return edge_isr_init(priv);
 }
 
 static esp_err_t pulse_counter_deinit(imp_sensor_priv_t *priv)
@@ -153,29 +205,130 @@ static esp_err_t pulse_counter_deinit(imp_sensor_priv_t *priv)
     return ESP_OK;
 }
 
-static void timer_event_callback(void *arg)
+static uint64_t pulse_counter_total(imp_sensor_priv_t *priv)
 {
-    imp_sensor_priv_t *priv = (imp_sensor_priv_t *)arg;
-
     PORT_ENTER_CRITICAL();
-    priv->pps = priv->pulse_count;
-    priv->pulse_count = 0;
+    uint32_t edges = priv->edges;
     PORT_EXIT_CRITICAL();
+
+    /* unsigned difference survives 32-bit wrap of edges counter */
+    return priv->total + (uint32_t)(edges - (uint32_t)priv->total);
 }
 
 #endif
 
-static esp_err_t timer_setup(imp_sensor_priv_t *priv, const uint32_t period)
+static void update_sensor(imp_sensor_priv_t *priv, int64_t now)
+{
+    uint64_t total = pulse_counter_total(priv);
+    uint64_t pulses = total - priv->total;
+    float rate = pulses * 1000000.0f / (now - priv->last_update);
+
+    if (priv->edge_timestamps)
+    {
+        PORT_ENTER_CRITICAL();
+        uint32_t edges = priv->edges;
+        int64_t last_edge = priv->last_edge;
+        PORT_EXIT_CRITICAL();
+
+        uint32_t new_edges = edges - priv->prev_edges;
+        if (new_edges && priv->prev_edge && pulses < IMP_SENSOR_PERIOD_MODE_PULSES)
+        {
+            /* exact average between the first and the last edge */
+            rate = new_edges * 1000000.0f / (last_edge - priv->prev_edge);
+        }
+        else if (!new_edges && priv->prev_edge)
+        {
+            /* no edges in this period, rate is at most 1 / time since last edge */
+            float bound = 1000000.0f / (now - priv->prev_edge);
+            rate = bound < priv->last_rate ? bound : priv->last_rate;
+        }
+        if (new_edges)
+        {
+            priv->prev_edges = edges;
+            priv->prev_edge = last_edge;
+        }
+    }
+
+    priv->rates[priv->rate_pos] = rate;
+    priv->rate_pos = (priv->rate_pos + 1) % priv->window;
+    if (priv->rate_len < priv->window)
+        priv->rate_len++;
+    float sum = 0;
+    for (uint32_t i = 0; i < priv->rate_len; i++)
+        sum += priv->rates[i];
+
+    priv->total = total;
+    priv->last_update = now;
+    priv->last_rate = rate;
+
+    /* seqlock: odd sequence means update in progress */
+    __atomic_add_fetch(&priv->seq, 1, __ATOMIC_RELEASE);
+    priv->snapshot.count = total;
+    priv->snapshot.rate = rate;
+    priv->snapshot.average = sum / priv->rate_len;
+    priv->snapshot.timestamp = now;
+    __atomic_add_fetch(&priv->seq, 1, __ATOMIC_RELEASE);
+}
+
+static void timer_event_callback(void *arg)
 {
-    esp_timer_create_args_t timer_args = {
-        .name = "imp-sensor",
-        .dispatch_method = ESP_TIMER_TASK,
-        .callback = timer_event_callback,
-        .arg = priv,
-    };
+    if (xSemaphoreTake(service_lock, 0) != pdTRUE)
+        return;
+
+    int64_t now = esp_timer_get_time();
+    for (imp_sensor_priv_t *priv = sensors; priv; priv = priv->next)
+    {
+        /* half of service period tolerance for timer jitter */
+        if ((now - priv->last_update) + service_period_ms * 500 >= (int64_t)priv->period_ms * 1000)
+            update_sensor(priv, now);
+    }
+
+    xSemaphoreGive(service_lock);
+}
+
+/* must be called with service_lock taken */
+static esp_err_t service_restart(void)
+{
+    uint32_t period = 0;
+    for (imp_sensor_priv_t *priv = sensors; priv; priv = priv->next)
+        if (!period || priv->period_ms < period)
+            period = priv->period_ms;
+
+    if (!service_timer)
+    {
+        esp_timer_create_args_t timer_args = {
+            .name = "imp-sensor",
+            .dispatch_method = ESP_TIMER_TASK,
+            .callback = timer_event_callback,
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &service_timer));
+    }
+    else if (esp_timer_is_active(service_timer))
+        ESP_ERROR_CHECK(esp_timer_stop(service_timer));
+
+    service_period_ms = period;
+    if (period)
+        ESP_ERROR_CHECK(esp_timer_start_periodic(service_timer, period * 1000));
+    return ESP_OK;
+}
+
+static esp_err_t service_lock_init(void)
+{
+    if (service_lock)
+        return ESP_OK;
+
+    SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+    if (!lock)
+        return ESP_ERR_NO_MEM;
 
-    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &priv->timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(priv->timer, period * 1000));
+    PORT_ENTER_CRITICAL();
+    bool created = !service_lock;
+    if (created)
+        service_lock = lock;
+    PORT_EXIT_CRITICAL();
+
+    if (!created)
+        vSemaphoreDelete(lock);
     return ESP_OK;
 }
 
@@ -183,17 +336,25 @@ esp_err_t imp_sensor_init(const imp_sensor_config_t *conf, imp_sensor_t *imp_sen
 {
     CHECK_ARG(conf);
     CHECK_ARG(imp_sensor);
+    CHECK_ARG(conf->avg_window <= IMP_SENSOR_MAX_AVG_WINDOW);
 
     imp_sensor_priv_t *priv;
     esp_err_t rc;
     const uint32_t timer_period_ms = conf->meas_period ? conf->meas_period : IMP_SENSOR_DEFAULT_MEAS_PERIOD;
 
+    rc = service_lock_init();
+    if (rc != ESP_OK)
+        return rc;
+
     priv = (imp_sensor_priv_t *)calloc(1, sizeof(imp_sensor_priv_t));
     if (priv == NULL)
         return ESP_ERR_NO_MEM;
 
     priv->input_pin = conf->input_pin;
     priv->sf = conf->scale_factor ? conf->scale_factor : IMP_SENSOR_DEFAULT_SF;
+    priv->period_ms = timer_period_ms;
+    priv->window = conf->avg_window ? conf->avg_window : IMP_SENSOR_DEFAULT_AVG_WINDOW;
+    priv->edge_timestamps = conf->edge_timestamps;
 
     rc = pulse_counter_init(priv);
     if (rc != ESP_OK)
@@ -201,14 +362,22 @@ esp_err_t imp_sensor_init(const imp_sensor_config_t *conf, imp_sensor_t *imp_sen
         free(priv);
         return rc;
     }
+    priv->last_update = esp_timer_get_time();
 
-    rc = timer_setup(priv, timer_period_ms);
+    xSemaphoreTake(service_lock, portMAX_DELAY);
+    priv->next = sensors;
+    sensors = priv;
+    rc = service_restart();
     if (rc != ESP_OK)
     {
+        sensors = priv->next;
+        xSemaphoreGive(service_lock);
         pulse_counter_deinit(priv);
         free(priv);
         return rc;
     }
+    xSemaphoreGive(service_lock);
+
     *imp_sensor = priv;
     return ESP_OK;
 }
@@ -218,21 +387,51 @@ esp_err_t imp_sensor_deinit(imp_sensor_t *imp_sensor)
     CHECK_ARG(imp_sensor);
     imp_sensor_priv_t *priv = (imp_sensor_priv_t *)imp_sensor;
 
-    ESP_ERROR_CHECK(esp_timer_stop(priv->timer));
+    xSemaphoreTake(service_lock, portMAX_DELAY);
+    for (imp_sensor_priv_t **p = &sensors; *p; p = &(*p)->next)
+        if (*p == priv)
+        {
+            *p = priv->next;
+            break;
+        }
+    esp_err_t rc = service_restart();
+    xSemaphoreGive(service_lock);
+    if (rc != ESP_OK)
+        return rc;
+
     pulse_counter_deinit(priv);
     free(priv);
     return ESP_OK;
 }
 
+esp_err_t imp_sensor_get_snapshot(imp_sensor_t *imp_sensor, imp_sensor_snapshot_t *snapshot)
+{
+    CHECK_ARG(imp_sensor);
+    CHECK_ARG(snapshot);
+
+    imp_sensor_priv_t *priv = (imp_sensor_priv_t *)imp_sensor;
+
+    uint32_t seq;
+    do
+    {
+        seq = __atomic_load_n(&priv->seq, __ATOMIC_ACQUIRE);
+        memcpy(snapshot, &priv->snapshot, sizeof(imp_sensor_snapshot_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&priv->seq, __ATOMIC_ACQUIRE));
+
+    return ESP_OK;
+}
+
 esp_err_t imp_sensor_get_value(imp_sensor_t *imp_sensor, float *value)
 {
     CHECK_ARG(imp_sensor);
     CHECK_ARG(value);
 
     imp_sensor_priv_t *priv = (imp_sensor_priv_t *)imp_sensor;
+    imp_sensor_snapshot_t snapshot;
 
-    PORT_ENTER_CRITICAL();
-    *value = priv->sf * priv->pps;
-    PORT_EXIT_CRITICAL();
+    imp_sensor_get_snapshot(imp_sensor, &snapshot);
+    *value = priv->sf * snapshot.rate * priv->period_ms / 1000;
     return ESP_OK;
 }
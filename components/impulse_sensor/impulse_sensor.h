@@ -48,6 +48,9 @@ extern "C" {
 
 #define IMP_SENSOR_DEFAULT_SF          1.0  ///< default scale factor
 #define IMP_SENSOR_DEFAULT_MEAS_PERIOD 1000 ///< default measurement period[1sec]
+#define IMP_SENSOR_DEFAULT_AVG_WINDOW  8    ///< default rolling average window[periods]
+#define IMP_SENSOR_MAX_AVG_WINDOW      32   ///< maximal rolling average window[periods]
+#define IMP_SENSOR_PERIOD_MODE_PULSES  16   ///< below this count per period rate is measured from edge timestamps
 
 /**
  * Device descriptor
@@ -60,8 +63,21 @@ typedef struct
     gpio_num_t input_pin;       //!< GPIO input pin
     const float scale_factor;   //!< scale factor
     const uint32_t meas_period; //!< measurement period[msecs]
+    const uint32_t avg_window;  //!< rolling average window[periods], 0 for default
+    const bool edge_timestamps; //!< timestamp every edge for accurate low rates (costs an interrupt per pulse)
 } imp_sensor_config_t;
 
+/**
+ * Measurement snapshot
+ */
+typedef struct
+{
+    uint64_t count;    //!< total pulses since init
+    float rate;        //!< rate over the last period[pulses/sec]
+    float average;     //!< rolling average rate[pulses/sec]
+    int64_t timestamp; //!< snapshot time[usecs since boot]
+} imp_sensor_snapshot_t;
+
 /**
  * @brief Init impulse sensor
  *
@@ -80,7 +96,7 @@ esp_err_t imp_sensor_init(const imp_sensor_config_t *conf, imp_sensor_t *imp_sen
 esp_err_t imp_sensor_deinit(imp_sensor_t *imp_sensor);
 
 /**
- * @brief Deinit impulse sensor
+ * @brief Get pulses count per measurement period
  *
  * @param imp_sensor Pointer to sensor device
  * @param[out] value Output value multiplied by scale factor
@@ -88,6 +104,19 @@ esp_err_t imp_sensor_deinit(imp_sensor_t *imp_sensor);
  */
 esp_err_t imp_sensor_get_value(imp_sensor_t *imp_sensor, float *value);
 
+/**
+ * @brief Get the latest measurement snapshot
+ *
+ * Snapshot is updated once per measurement period. This function
+ * does not block and does not access hardware. Values are not
+ * multiplied by scale factor.
+ *
+ * @param imp_sensor Pointer to sensor device
+ * @param[out] snapshot Measurement snapshot
+ * @return `ESP_OK` on success
+ */
+esp_err_t imp_sensor_get_snapshot(imp_sensor_t *imp_sensor, imp_sensor_snapshot_t *snapshot);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ioexp.c
+ *
+ * ESP-IDF generic GPIO expander layer with shadow registers
+ *
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <esp_log.h>
+#include <esp_attr.h>
+#include "ioexp.h"
+
+static const char *TAG = "ioexp";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+#define CHECK_LOGE(exp, x, msg, ...) do { \
+        esp_err_t __; \
+        if ((__ = x) != ESP_OK) { \
+            xSemaphoreGive((exp)->lock); \
+            ESP_LOGE(TAG, msg, ## __VA_ARGS__); \
+            return __; \
+        } \
+    } while (0)
+#define BV(x) (1 << (x))
+
+#define STAGED_OUTPUT BV(0)
+#define STAGED_MODE   BV(1)
+#define STAGED_PULLUP BV(2)
+
+#define PIN_MASK(exp) ((uint16_t)((1UL << (exp)->ops->pins) - 1))
+
+static void IRAM_ATTR int_handler(void *arg)
+{
+    ((ioexp_t *)arg)->int_seq++;
+}
+
+static void timer_cb(void *arg)
+{
+    ioexp_t *exp = (ioexp_t *)arg;
+
+    esp_err_t res = ioexp_commit(exp);
+    if (res != ESP_OK)
+        ESP_LOGW(TAG, "Auto commit failed: %d (%s)", res, esp_err_to_name(res));
+}
+
+// quasi-bidirectional chips have inputs written as high outputs
+static inline uint16_t output_value(ioexp_t *exp)
+{
+    return exp->ops->write_mode ? exp->output : exp->output | exp->mode;
+}
+
+// must be called with lock taken
+static esp_err_t commit(ioexp_t *exp)
+{
+    // quasi-bidirectional chips switch modes by writing outputs
+    if ((exp->staged & STAGED_MODE) && !exp->ops->write_mode)
+        exp->staged = (exp->staged & ~STAGED_MODE) | STAGED_OUTPUT;
+
+    // output latch goes first, so pins turned to outputs drive the new
+    // level right away instead of the stale one
+    if (exp->staged & STAGED_OUTPUT)
+    {
+        CHECK(exp->ops->write_output(exp->dev, output_value(exp)));
+        exp->transactions++;
+        exp->staged &= ~STAGED_OUTPUT;
+    }
+    if (exp->staged & STAGED_MODE)
+    {
+        CHECK(exp->ops->write_mode(exp->dev, exp->mode));
+        exp->transactions++;
+        exp->staged &= ~STAGED_MODE;
+    }
+    if (exp->staged & STAGED_PULLUP)
+    {
+        if (exp->ops->write_pullup)
+        {
+            CHECK(exp->ops->write_pullup(exp->dev, exp->pullup));
+            exp->transactions++;
+        }
+        exp->staged &= ~STAGED_PULLUP;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t stage(ioexp_t *exp, uint16_t *reg, uint8_t flag, uint16_t mask, uint16_t val)
+{
+    CHECK_ARG(exp && exp->lock);
+
+    mask &= PIN_MASK(exp);
+    xSemaphoreTake(exp->lock, portMAX_DELAY);
+    uint16_t v = (*reg & ~mask) | (val & mask);
+    if (v != *reg)
+    {
+        *reg = v;
+        exp->staged |= flag;
+    }
+    xSemaphoreGive(exp->lock);
+
+    return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t ioexp_init(ioexp_t *exp, void *dev, const ioexp_ops_t *ops, uint16_t mode, uint16_t output, uint16_t pullup)
+{
+    CHECK_ARG(exp && dev && ops && ops->read_input && ops->write_output && (ops->pins == 8 || ops->pins == 16));
+
+    memset(exp, 0, sizeof(ioexp_t));
+    exp->dev = dev;
+    exp->ops = ops;
+    exp->int_gpio = GPIO_NUM_NC;
+    exp->mode = mode & PIN_MASK(exp);
+    exp->output = output & PIN_MASK(exp);
+    exp->pullup = pullup & PIN_MASK(exp);
+    exp->staged = STAGED_MODE | STAGED_PULLUP;
+
+    exp->lock = xSemaphoreCreateMutex();
+    if (!exp->lock)
+        return ESP_ERR_NO_MEM;
+
+    // outputs first to avoid glitches on pins switched to output mode
+    xSemaphoreTake(exp->lock, portMAX_DELAY);
+    esp_err_t res = exp->ops->write_output(exp->dev, output_value(exp));
+    if (res == ESP_OK)
+    {
+        exp->transactions++;
+        res = commit(exp);
+    }
+    xSemaphoreGive(exp->lock);
+    if (res != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error writing initial state: %d (%s)", res, esp_err_to_name(res));
+        vSemaphoreDelete(exp->lock);
+        exp->lock = NULL;
+    }
+
+    return res;
+}
+
+esp_err_t ioexp_free(ioexp_t *exp)
+{
+    CHECK_ARG(exp && exp->lock);
+
+    CHECK(ioexp_set_auto_commit(exp, 0));
+    CHECK(ioexp_set_int_gpio(exp, GPIO_NUM_NC, GPIO_INTR_DISABLE));
+    CHECK(ioexp_commit(exp));
+
+    vSemaphoreDelete(exp->lock);
+    exp->lock = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t ioexp_set_auto_commit(ioexp_t *exp, uint32_t period_ms)
+{
+    CHECK_ARG(exp && exp->lock);
+
+    if (exp->timer)
+    {
+        esp_timer_stop(exp->timer);
+        if (!period_ms)
+        {
+            CHECK(esp_timer_delete(exp->timer));
+            exp->timer = NULL;
+            return ESP_OK;
+        }
+    }
+    if (!period_ms)
+        return ESP_OK;
+
+    if (!exp->timer)
+    {
+        esp_timer_create_args_t args = {
+            .callback = timer_cb,
+            .arg = exp,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "ioexp",
+        };
+        CHECK(esp_timer_create(&args, &exp->timer));
+    }
+
+    return esp_timer_start_periodic(exp->timer, (uint64_t)period_ms * 1000);
+}
+
+esp_err_t ioexp_set_int_gpio(ioexp_t *exp, gpio_num_t gpio, gpio_int_type_t edge)
+{
+    CHECK_ARG(exp && exp->lock);
+
+    if (exp->int_gpio != GPIO_NUM_NC)
+    {
+        gpio_isr_handler_remove(exp->int_gpio);
+        exp->int_gpio = GPIO_NUM_NC;
+    }
+    // cache is not valid without interrupts
+    exp->int_seq++;
+    if (gpio == GPIO_NUM_NC)
+        return ESP_OK;
+
+    esp_err_t res = gpio_install_isr_service(0);
+    if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+        return res;
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = BIT64(gpio),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = edge == GPIO_INTR_NEGEDGE ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = edge,
+    };
+    CHECK(gpio_config(&io_conf));
+    CHECK(gpio_isr_handler_add(gpio, int_handler, exp));
+    exp->int_gpio = gpio;
+
+    return ESP_OK;
+}
+
+esp_err_t ioexp_commit(ioexp_t *exp)
+{
+    CHECK_ARG(exp && exp->lock);
+
+    xSemaphoreTake(exp->lock, portMAX_DELAY);
+    CHECK_LOGE(exp, commit(exp), "Error writing registers");
+    xSemaphoreGive(exp->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t ioexp_port_update(ioexp_t *exp, uint16_t mask, uint16_t val)
+{
+    CHECK_ARG(exp);
+
+    return stage(exp, &exp->output, STAGED_OUTPUT, mask, val);
+}
+
+esp_err_t ioexp_port_update_mode(ioexp_t *exp, uint16_t mask, uint16_t val)
+{
+    CHECK_ARG(exp);
+
+    return stage(exp, &exp->mode, STAGED_MODE, mask, val);
+}
+
+esp_err_t ioexp_port_update_pullup(ioexp_t *exp, uint16_t mask, uint16_t val)
+{
+    CHECK_ARG(exp);
+
+    return stage(exp, &exp->pullup, STAGED_PULLUP, mask, val);
+}
+
+esp_err_t ioexp_port_read(ioexp_t *exp, uint16_t *val)
+{
+    CHECK_ARG(exp && exp->lock && val);
+
+    xSemaphoreTake(exp->lock, portMAX_DELAY);
+    uint32_t seq = exp->int_seq;
+    if (exp->int_gpio == GPIO_NUM_NC || !exp->input_valid || exp->input_seq != seq)
+    {
+        CHECK_LOGE(exp, exp->ops->read_input(exp->dev, &exp->input), "Error reading input port");
+        exp->transactions++;
+        exp->input_seq = seq;
+        exp->input_valid = true;
+    }
+    *val = exp->input;
+    xSemaphoreGive(exp->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t ioexp_set_level(ioexp_t *exp, uint8_t pin, uint32_t val)
+{
+    CHECK_ARG(exp && exp->ops && pin < exp->ops->pins);
+
+    return ioexp_port_update(exp, BV(pin), val ? BV(pin) : 0);
+}
+
+esp_err_t ioexp_get_level(ioexp_t *exp, uint8_t pin, uint32_t *val)
+{
+    CHECK_ARG(exp && exp->ops && pin < exp->ops->pins && val);
+
+    uint16_t v;
+    CHECK(ioexp_port_read(exp, &v));
+    *val = v & BV(pin) ? 1 : 0;
+
+    return ESP_OK;
+}
+
+esp_err_t ioexp_set_mode(ioexp_t *exp, uint8_t pin, bool input)
+{
+    CHECK_ARG(exp && exp->ops && pin < exp->ops->pins);
+
+    return ioexp_port_update_mode(exp, BV(pin), input ? BV(pin) : 0);
+}
+
+esp_err_t ioexp_set_pullup(ioexp_t *exp, uint8_t pin, bool enable)
+{
+    CHECK_ARG(exp && exp->ops && pin < exp->ops->pins);
+
+    return ioexp_port_update_pullup(exp, BV(pin), enable ? BV(pin) : 0);
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ioexp.h
+ * @defgroup ioexp ioexp
+ * @{
+ *
+ * ESP-IDF generic GPIO expander layer with shadow registers
+ *
+ * Output, direction and pull-up registers are cached, pin changes are
+ * staged in the cache and written to the chip by ::ioexp_commit() with
+ * one bus transaction per changed register. Input port is cached as well
+ * and reread only after the expander interrupt line has signalled a change.
+ *
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __IOEXP_H__
+#define __IOEXP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Chip driver operations. Each function performs exactly one bus transaction.
+ */
+typedef struct
+{
+    uint8_t pins;                                             //!< Number of pins, 8 or 16
+    esp_err_t (*read_input)(void *dev, uint16_t *val);        //!< Read input port
+    esp_err_t (*write_output)(void *dev, uint16_t val);       //!< Write output latch
+    esp_err_t (*write_mode)(void *dev, uint16_t val);         //!< Write direction, 1 - input. NULL for
+                                                              //!< quasi-bidirectional chips, inputs are
+                                                              //!< then written as high outputs
+    esp_err_t (*write_pullup)(void *dev, uint16_t val);       //!< Write pull-ups, NULL if not supported
+    esp_err_t (*read_intr)(void *dev, uint16_t *flags, uint16_t *val); //!< Read interrupt flags and
+                                                              //!< state of all pins, captured at
+                                                              //!< interrupt for flagged ones, clears
+                                                              //!< interrupt. NULL if chip has no flags
+} ioexp_ops_t;
+
+/**
+ * Expander descriptor
+ */
+typedef struct
+{
+    void *dev;                    //!< Chip device descriptor
+    const ioexp_ops_t *ops;       //!< Chip driver operations
+    SemaphoreHandle_t lock;       //!< Cache and bus mutex
+    esp_timer_handle_t timer;     //!< Auto commit timer
+    gpio_num_t int_gpio;          //!< Interrupt line GPIO or GPIO_NUM_NC
+    uint16_t output;              //!< Output latch shadow
+    uint16_t mode;                //!< Direction shadow, 1 - input
+    uint16_t pullup;              //!< Pull-ups shadow
+    uint8_t staged;               //!< Shadow registers changed since last commit
+    uint16_t input;               //!< Cached input port
+    volatile uint32_t int_seq;    //!< Incremented by interrupt handler
+    uint32_t input_seq;           //!< Value of `int_seq` when `input` was read
+    bool input_valid;             //!< `input` has been read at least once
+    uint32_t transactions;        //!< Number of bus transactions performed
+} ioexp_t;
+
+/**
+ * @brief Initialize expander descriptor and write initial register values
+ *
+ * Chip device descriptor must be initialized before calling this function.
+ *
+ * @param exp Expander descriptor
+ * @param dev Chip device descriptor
+ * @param ops Chip driver operations
+ * @param mode Initial direction, 1 - input for each bit
+ * @param output Initial output levels
+ * @param pullup Initial pull-ups, ignored if chip has no pull-ups
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_init(ioexp_t *exp, void *dev, const ioexp_ops_t *ops, uint16_t mode, uint16_t output, uint16_t pullup);
+
+/**
+ * @brief Commit staged changes, stop auto commit and free descriptor
+ *
+ * @param exp Expander descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_free(ioexp_t *exp);
+
+/**
+ * @brief Enable periodic commit of staged changes
+ *
+ * @param exp Expander descriptor
+ * @param period_ms Commit period, ms. 0 to disable
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_set_auto_commit(ioexp_t *exp, uint32_t period_ms);
+
+/**
+ * @brief Use interrupt line of expander for input cache invalidation
+ *
+ * Interrupts of the chip must be configured to fire on any change of
+ * interesting inputs. Without interrupt line every input read goes to the bus.
+ *
+ * @param exp Expander descriptor
+ * @param gpio GPIO connected to the interrupt line, GPIO_NUM_NC to detach
+ * @param edge Active edge of interrupt line
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_set_int_gpio(ioexp_t *exp, gpio_num_t gpio, gpio_int_type_t edge);
+
+/**
+ * @brief Write staged changes to the chip
+ *
+ * Only changed registers are written, one bus transaction each.
+ *
+ * @param exp Expander descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_commit(ioexp_t *exp);
+
+/**
+ * @brief Stage output levels of group of pins
+ *
+ * @param exp Expander descriptor
+ * @param mask Pins to change
+ * @param val Levels
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_port_update(ioexp_t *exp, uint16_t mask, uint16_t val);
+
+/**
+ * @brief Stage directions of group of pins
+ *
+ * @param exp Expander descriptor
+ * @param mask Pins to change
+ * @param val Directions, 1 - input
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_port_update_mode(ioexp_t *exp, uint16_t mask, uint16_t val);
+
+/**
+ * @brief Stage pull-ups of group of pins
+ *
+ * @param exp Expander descriptor
+ * @param mask Pins to change
+ * @param val Pull-ups, 1 - enabled
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_port_update_pullup(ioexp_t *exp, uint16_t mask, uint16_t val);
+
+/**
+ * @brief Read input port
+ *
+ * Bus is accessed only if the cached value is invalidated by interrupt
+ * or no interrupt line is attached.
+ *
+ * @param exp Expander descriptor
+ * @param[out] val Input port value
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_port_read(ioexp_t *exp, uint16_t *val);
+
+/**
+ * @brief Stage output level of pin
+ *
+ * @param exp Expander descriptor
+ * @param pin Pin number
+ * @param val Level
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_set_level(ioexp_t *exp, uint8_t pin, uint32_t val);
+
+/**
+ * @brief Read input level of pin, see ::ioexp_port_read()
+ *
+ * @param exp Expander descriptor
+ * @param pin Pin number
+ * @param[out] val Level
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_get_level(ioexp_t *exp, uint8_t pin, uint32_t *val);
+
+/**
+ * @brief Stage direction of pin
+ *
+ * @param exp Expander descriptor
+ * @param pin Pin number
+ * @param input true for input
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_set_mode(ioexp_t *exp, uint8_t pin, bool input);
+
+/**
+ * @brief Stage pull-up of pin
+ *
+ * @param exp Expander descriptor
+ * @param pin Pin number
+ * @param enable true to enable pull-up
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_set_pullup(ioexp_t *exp, uint8_t pin, bool enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __IOEXP_H__ */
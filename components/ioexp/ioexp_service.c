@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ioexp_service.c
+ *
+ * Interrupt-driven input change service for GPIO expanders
+ *
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <esp_log.h>
+#include <esp_attr.h>
+#include "ioexp_service.h"
+
+static const char *TAG = "ioexp_service";
+
+#define TASK_STACK_SIZE 3072
+// line is reread at most this number of times while it stays active
+#define MAX_LINE_PASSES 8
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+#define BV(x) (1 << (x))
+
+static void IRAM_ATTR isr_handler(void *arg)
+{
+    ioexp_service_chip_t *chip = (ioexp_service_chip_t *)arg;
+    ioexp_service_t *svc = chip->service;
+    BaseType_t woken = pdFALSE;
+
+    svc->timestamps[chip->index] = esp_timer_get_time();
+    xTaskNotifyFromISR(svc->task, BV(chip->index), eSetBits, &woken);
+    if (woken == pdTRUE)
+        portYIELD_FROM_ISR();
+}
+
+static void post(ioexp_service_t *svc, ioexp_service_chip_t *chip, uint16_t changed, uint16_t state, int64_t timestamp)
+{
+    ioexp_event_t event = { .timestamp = timestamp, .chip = chip->index };
+
+    for (uint8_t pin = 0; changed; pin++, changed >>= 1)
+    {
+        if (!(changed & 1))
+            continue;
+        event.pin = pin;
+        event.level = (state >> pin) & 1;
+        svc->events++;
+        if (xQueueSend(svc->queue, &event, 0) != pdTRUE)
+            svc->dropped++;
+    }
+}
+
+// read chip state from the bus in one transaction, bypassing the input
+// cache, so the interrupt is always cleared
+static esp_err_t read_chip(ioexp_t *exp, uint16_t *state)
+{
+    uint16_t flags = 0;
+    esp_err_t res;
+
+    xSemaphoreTake(exp->lock, portMAX_DELAY);
+    if (exp->ops->read_intr)
+        res = exp->ops->read_intr(exp->dev, &flags, state);
+    else
+        res = exp->ops->read_input(exp->dev, state);
+    if (res == ESP_OK)
+    {
+        exp->transactions++;
+        exp->input = *state;
+        exp->input_seq = exp->int_seq;
+        exp->input_valid = true;
+    }
+    xSemaphoreGive(exp->lock);
+
+    return res;
+}
+
+// read chip state and post changes
+static void poll_chip(ioexp_service_t *svc, ioexp_service_chip_t *chip, int64_t timestamp)
+{
+    uint16_t state;
+    esp_err_t res = read_chip(chip->exp, &state);
+    if (res != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Chip %d: error reading state: %d (%s)", chip->index, res, esp_err_to_name(res));
+        return;
+    }
+
+    uint16_t changed = (state ^ chip->state) & chip->mask;
+    chip->state = state;
+    post(svc, chip, changed, state, timestamp);
+}
+
+static inline bool line_active(ioexp_service_chip_t *chip)
+{
+    return gpio_get_level(chip->gpio) == (chip->active_low ? 0 : 1);
+}
+
+static void worker(void *arg)
+{
+    ioexp_service_t *svc = (ioexp_service_t *)arg;
+    uint32_t lines;
+
+    while (true)
+    {
+        xTaskNotifyWait(0, UINT32_MAX, &lines, portMAX_DELAY);
+
+        xSemaphoreTake(svc->lock, portMAX_DELAY);
+        for (size_t l = 0; l < IOEXP_SERVICE_MAX_CHIPS; l++)
+        {
+            ioexp_service_chip_t *owner = svc->chips[l];
+            if (!(lines & BV(l)) || !owner)
+                continue;
+            int64_t timestamp = svc->timestamps[l];
+
+            // Edge of shared line is not repeated while another chip holds it
+            // active, so all chips of the line are polled until it is released
+            for (size_t pass = 0; pass < MAX_LINE_PASSES; pass++)
+            {
+                for (size_t i = 0; i < IOEXP_SERVICE_MAX_CHIPS; i++)
+                    if (svc->chips[i] && svc->chips[i]->gpio == owner->gpio)
+                        poll_chip(svc, svc->chips[i], timestamp);
+                if (!line_active(owner))
+                    break;
+            }
+            if (line_active(owner))
+                ESP_LOGW(TAG, "Interrupt line %d is stuck active", owner->gpio);
+        }
+        xSemaphoreGive(svc->lock);
+    }
+}
+
+static ioexp_service_chip_t *find_line(ioexp_service_t *svc, gpio_num_t gpio, ioexp_service_chip_t *except)
+{
+    for (size_t i = 0; i < IOEXP_SERVICE_MAX_CHIPS; i++)
+        if (svc->chips[i] && svc->chips[i] != except && svc->chips[i]->gpio == gpio)
+            return svc->chips[i];
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t ioexp_service_init(ioexp_service_t *svc, size_t queue_size, UBaseType_t priority)
+{
+    CHECK_ARG(svc && queue_size);
+
+    esp_err_t res = gpio_install_isr_service(0);
+    if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+        return res;
+
+    memset(svc, 0, sizeof(ioexp_service_t));
+
+    svc->lock = xSemaphoreCreateMutex();
+    svc->queue = xQueueCreate(queue_size, sizeof(ioexp_event_t));
+    if (!svc->lock || !svc->queue
+            || xTaskCreate(worker, TAG, TASK_STACK_SIZE, svc, priority, &svc->task) != pdPASS)
+    {
+        if (svc->queue)
+            vQueueDelete(svc->queue);
+        if (svc->lock)
+            vSemaphoreDelete(svc->lock);
+        svc->queue = NULL;
+        svc->lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ioexp_service_done(ioexp_service_t *svc)
+{
+    CHECK_ARG(svc && svc->task);
+
+    for (size_t i = 0; i < IOEXP_SERVICE_MAX_CHIPS; i++)
+        if (svc->chips[i])
+            return ESP_ERR_INVALID_STATE;
+
+    vTaskDelete(svc->task);
+    svc->task = NULL;
+    vQueueDelete(svc->queue);
+    svc->queue = NULL;
+    vSemaphoreDelete(svc->lock);
+    svc->lock = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t ioexp_service_add(ioexp_service_t *svc, ioexp_service_chip_t *chip, ioexp_t *exp,
+        gpio_num_t gpio, bool active_low, uint16_t mask)
+{
+    CHECK_ARG(svc && svc->task && chip && exp && exp->lock);
+
+    xSemaphoreTake(svc->lock, portMAX_DELAY);
+
+    uint8_t index = IOEXP_SERVICE_MAX_CHIPS;
+    for (uint8_t i = 0; i < IOEXP_SERVICE_MAX_CHIPS; i++)
+        if (!svc->chips[i])
+        {
+            index = i;
+            break;
+        }
+    if (index == IOEXP_SERVICE_MAX_CHIPS)
+    {
+        xSemaphoreGive(svc->lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(chip, 0, sizeof(ioexp_service_chip_t));
+    chip->exp = exp;
+    chip->service = svc;
+    chip->gpio = gpio;
+    chip->active_low = active_low;
+    chip->index = index;
+    chip->mask = mask;
+
+    // initial state, also clears pending interrupt
+    esp_err_t res = read_chip(exp, &chip->state);
+    if (res == ESP_OK && !find_line(svc, gpio, NULL))
+    {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = BIT64(gpio),
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = active_low ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = active_low ? GPIO_INTR_NEGEDGE : GPIO_INTR_POSEDGE,
+        };
+        res = gpio_config(&io_conf);
+        if (res == ESP_OK)
+            res = gpio_isr_handler_add(gpio, isr_handler, chip);
+        chip->isr_owner = res == ESP_OK;
+    }
+    if (res == ESP_OK)
+        svc->chips[index] = chip;
+
+    xSemaphoreGive(svc->lock);
+
+    if (res == ESP_OK)
+        ESP_LOGD(TAG, "Chip %d added on INT=%d", index, gpio);
+
+    return res;
+}
+
+esp_err_t ioexp_service_remove(ioexp_service_chip_t *chip)
+{
+    CHECK_ARG(chip && chip->service);
+
+    ioexp_service_t *svc = chip->service;
+    esp_err_t res = ESP_OK;
+
+    xSemaphoreTake(svc->lock, portMAX_DELAY);
+    svc->chips[chip->index] = NULL;
+    if (chip->isr_owner)
+    {
+        gpio_isr_handler_remove(chip->gpio);
+        chip->isr_owner = false;
+        // pass the line to the next chip sharing it
+        ioexp_service_chip_t *next = find_line(svc, chip->gpio, chip);
+        if (next)
+        {
+            res = gpio_isr_handler_add(next->gpio, isr_handler, next);
+            next->isr_owner = res == ESP_OK;
+        }
+        else
+            gpio_intr_disable(chip->gpio);
+    }
+    chip->service = NULL;
+    xSemaphoreGive(svc->lock);
+
+    return res;
+}
+
+esp_err_t ioexp_service_wait(ioexp_service_t *svc, ioexp_event_t *event, TickType_t timeout)
+{
+    CHECK_ARG(svc && svc->queue && event);
+
+    return xQueueReceive(svc->queue, event, timeout) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ioexp_service.h
+ * @defgroup ioexp_service ioexp_service
+ * @{
+ *
+ * Interrupt-driven input change service for GPIO expanders
+ *
+ * Interrupt lines of expanders are handled by GPIO ISRs which only record
+ * the time and wake up a single worker task. Worker reads interrupt flags
+ * and captured port (or the whole input port for chips without flags) of
+ * every expander on the signalled line in one bus transaction, compares it
+ * with the last known state and posts pin change events to a queue.
+ * Several expanders may share one open-drain interrupt line.
+ *
+ * Copyright (c) 2024 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __IOEXP_SERVICE_H__
+#define __IOEXP_SERVICE_H__
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "ioexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IOEXP_SERVICE_MAX_CHIPS 16 //!< Maximum number of expanders per service
+
+/**
+ * Pin change event
+ */
+typedef struct
+{
+    int64_t timestamp;  //!< Time of interrupt, us since boot
+    uint8_t chip;       //!< Expander index in service
+    uint8_t pin;        //!< Pin number
+    uint8_t level;      //!< New pin level
+} ioexp_event_t;
+
+typedef struct ioexp_service ioexp_service_t;
+
+/**
+ * Expander attached to service
+ */
+typedef struct
+{
+    ioexp_t *exp;                 //!< Expander descriptor
+    ioexp_service_t *service;
+    gpio_num_t gpio;              //!< Interrupt line GPIO
+    bool active_low;              //!< Interrupt line is active low
+    bool isr_owner;               //!< GPIO ISR handler of the line is registered for this chip
+    uint8_t index;                //!< Index in service
+    uint16_t mask;                //!< Pins to watch
+    uint16_t state;               //!< Last known port state
+} ioexp_service_chip_t;
+
+/**
+ * Service descriptor
+ */
+struct ioexp_service
+{
+    ioexp_service_chip_t *chips[IOEXP_SERVICE_MAX_CHIPS];
+    volatile int64_t timestamps[IOEXP_SERVICE_MAX_CHIPS];
+    SemaphoreHandle_t lock;
+    TaskHandle_t task;
+    QueueHandle_t queue;          //!< Queue of ::ioexp_event_t
+    volatile uint32_t events;     //!< Number of posted events
+    volatile uint32_t dropped;    //!< Number of events dropped because queue was full
+};
+
+/**
+ * @brief Initialize service and start worker task
+ *
+ * @param svc Service descriptor
+ * @param queue_size Size of events queue
+ * @param priority Worker task priority
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_service_init(ioexp_service_t *svc, size_t queue_size, UBaseType_t priority);
+
+/**
+ * @brief Stop worker task and free resources
+ *
+ * All expanders must be removed before calling this function.
+ *
+ * @param svc Service descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_service_done(ioexp_service_t *svc);
+
+/**
+ * @brief Add expander to service
+ *
+ * Interrupts of the chip must be configured to fire on change of watched
+ * pins. Expander must not use ::ioexp_set_int_gpio(), its input cache is
+ * updated by the service.
+ *
+ * @param svc Service descriptor
+ * @param chip Descriptor of expander in service
+ * @param exp Expander descriptor
+ * @param gpio GPIO connected to interrupt line, may be shared with other expanders
+ * @param active_low true if interrupt line is active low
+ * @param mask Pins to watch
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_service_add(ioexp_service_t *svc, ioexp_service_chip_t *chip, ioexp_t *exp,
+        gpio_num_t gpio, bool active_low, uint16_t mask);
+
+/**
+ * @brief Remove expander from service
+ *
+ * @param chip Descriptor of expander in service
+ * @return `ESP_OK` on success
+ */
+esp_err_t ioexp_service_remove(ioexp_service_chip_t *chip);
+
+/**
+ * @brief Wait for pin change event
+ *
+ * @param svc Service descriptor
+ * @param[out] event Event
+ * @param timeout Timeout in RTOS ticks
+ * @return `ESP_OK` on success, `ESP_ERR_TIMEOUT` if no event received
+ */
+esp_err_t ioexp_service_wait(ioexp_service_t *svc, ioexp_event_t *event, TickType_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __IOEXP_SERVICE_H__ */
@@ -34,7 +34,11 @@
 #include <esp_log.h>
 #include <esp_attr.h>
 #include <stdlib.h>
+#include <string.h>
+#include <esp_heap_caps.h>
 #include <ets_sys.h>
+#include <esp_timer.h>
+#include <soc/soc_caps.h>
 #include <esp_idf_lib_helpers.h>
 
 #if HELPER_TARGET_IS_ESP8266
@@ -72,7 +76,7 @@ static const char *TAG = "led_strip";
 
 static void IRAM_ATTR _rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
                                    size_t wanted_num, size_t *translated_size, size_t *item_num,
-                                   const rmt_item32_t *bit0, const rmt_item32_t *bit1)
+                                   const rmt_item32_t *bit0, const rmt_item32_t *bit1, const uint8_t *channels)
 {
     if (!src || !dest)
     {
@@ -88,11 +92,35 @@ static void IRAM_ATTR _rmt_adapter(const void *src, rmt_item32_t *dest, size_t s
     led_strip_t *strip;
     esp_err_t r = rmt_translator_get_context(item_num, (void **)&strip);
     uint8_t brightness = r == ESP_OK ? strip->brightness : 255;
+    const color_correction_t *cc = r == ESP_OK ? strip->correction : NULL;
+    size_t color_size = 0, pos = 0, pixel = 0;
+    uint8_t dither = 0;
+    if (cc)
+    {
+        // translator is called for chunks of buffer, find out where we are
+        size_t offs = psrc - strip->buf;
+        color_size = COLOR_SIZE(strip);
+        pixel = offs / color_size;
+        pos = offs % color_size;
+        dither = color_correction_dither(cc, strip->frame, pixel);
+    }
 #endif
     while (size < src_size && num < wanted_num)
     {
 #ifdef LED_STRIP_BRIGHTNESS
-        uint8_t b = brightness != 255 ? scale8_video(*psrc, brightness) : *psrc;
+        uint8_t b = *psrc;
+        if (cc)
+        {
+            if (pos < 3)
+                b = color_correction_channel(cc, channels[pos], b, dither);
+            if (++pos == color_size)
+            {
+                pos = 0;
+                dither = color_correction_dither(cc, strip->frame, ++pixel);
+            }
+        }
+        if (brightness != 255)
+            b = scale8_video(b, brightness);
 #else
         uint8_t b = *psrc;
 #endif
@@ -110,34 +138,41 @@ static void IRAM_ATTR _rmt_adapter(const void *src, rmt_item32_t *dest, size_t s
     *item_num = num;
 }
 
+// color_correction_t channel of each byte of pixel
+static const DRAM_ATTR uint8_t channels_grb[3] = { 1, 0, 2 };
+static const DRAM_ATTR uint8_t channels_rgb[3] = { 0, 1, 2 };
+
 typedef struct {
     rmt_item32_t bit0, bit1;
 } led_rmt_t;
 
 static led_rmt_t rmt_items[LED_STRIP_TYPE_MAX] = { 0 };
 
+// RMT items of each byte value, allocated on first use of LED type
+static rmt_item32_t *byte_items[LED_STRIP_TYPE_MAX] = { 0 };
+
 static void IRAM_ATTR ws2812_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
         size_t wanted_num, size_t *translated_size, size_t *item_num)
 {
-    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_WS2812].bit0, &rmt_items[LED_STRIP_WS2812].bit1);
+    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_WS2812].bit0, &rmt_items[LED_STRIP_WS2812].bit1, channels_grb);
 }
 
 static void IRAM_ATTR sk6812_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
         size_t wanted_num, size_t *translated_size, size_t *item_num)
 {
-    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_SK6812].bit0, &rmt_items[LED_STRIP_SK6812].bit1);
+    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_SK6812].bit0, &rmt_items[LED_STRIP_SK6812].bit1, channels_grb);
 }
 
 static void IRAM_ATTR apa106_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
         size_t wanted_num, size_t *translated_size, size_t *item_num)
 {
-    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_APA106].bit0, &rmt_items[LED_STRIP_APA106].bit1);
+    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_APA106].bit0, &rmt_items[LED_STRIP_APA106].bit1, channels_rgb);
 }
 
 static void IRAM_ATTR sm16703_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
                                          size_t wanted_num, size_t *translated_size, size_t *item_num)
 {
-    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_SM16703].bit0, &rmt_items[LED_STRIP_SM16703].bit1);
+    _rmt_adapter(src, dest, src_size, wanted_num, translated_size, item_num, &rmt_items[LED_STRIP_SM16703].bit0, &rmt_items[LED_STRIP_SM16703].bit1, channels_rgb);
 }
 
 typedef enum {
@@ -158,6 +193,58 @@ static const led_params_t led_params[] = {
     [LED_STRIP_SM16703] = { .t0h = 300, .t0l = 900,  .t1h = 1360, .t1l = 350, .order = ORDER_RGB, .adapter = sm16703_rmt_adapter },
 };
 
+static esp_err_t init_byte_items(led_strip_type_t type)
+{
+    if (byte_items[type])
+        return ESP_OK;
+
+    rmt_item32_t *table = heap_caps_malloc(256 * 8 * sizeof(rmt_item32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!table)
+        return ESP_ERR_NO_MEM;
+    for (size_t b = 0; b < 256; b++)
+        for (size_t i = 0; i < 8; i++)
+            // MSB first
+            table[b * 8 + i] = b & (1 << (7 - i)) ? rmt_items[type].bit1 : rmt_items[type].bit0;
+    byte_items[type] = table;
+
+    return ESP_OK;
+}
+
+static void encode(led_strip_t *strip, size_t len)
+{
+    int64_t start = esp_timer_get_time();
+
+    const rmt_item32_t *table = byte_items[strip->type];
+    const uint8_t *src = strip->buf;
+    rmt_item32_t *dst = strip->items;
+#ifdef LED_STRIP_BRIGHTNESS
+    const color_correction_t *cc = strip->correction;
+    const uint8_t *channels = led_params[strip->type].order == ORDER_GRB ? channels_grb : channels_rgb;
+    size_t color_size = COLOR_SIZE(strip);
+#endif
+
+    for (size_t pixel = 0; pixel < len; pixel++)
+    {
+#ifdef LED_STRIP_BRIGHTNESS
+        uint8_t dither = cc ? color_correction_dither(cc, strip->frame, pixel) : 0;
+        for (size_t pos = 0; pos < color_size; pos++, src++, dst += 8)
+        {
+            uint8_t b = *src;
+            if (cc && pos < 3)
+                b = color_correction_channel(cc, channels[pos], b, dither);
+            if (strip->brightness != 255)
+                b = scale8_video(b, strip->brightness);
+            memcpy(dst, table + b * 8, 8 * sizeof(rmt_item32_t));
+        }
+#else
+        for (size_t pos = 0; pos < COLOR_SIZE(strip); pos++, src++, dst += 8)
+            memcpy(dst, table + *src * 8, 8 * sizeof(rmt_item32_t));
+#endif
+    }
+
+    strip->encode_us = esp_timer_get_time() - start;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void led_strip_install()
@@ -183,46 +270,109 @@ esp_err_t led_strip_init(led_strip_t *strip)
 {
     CHECK_ARG(strip && strip->length > 0 && strip->type < LED_STRIP_TYPE_MAX);
 
+    esp_err_t res;
+    bool installed = false;
+
+    strip->items = NULL;
     strip->buf = calloc(strip->length, COLOR_SIZE(strip));
     if (!strip->buf)
     {
         ESP_LOGE(TAG, "Not enough memory");
         return ESP_ERR_NO_MEM;
     }
+    strip->dirty = strip->length;
+
+    if (strip->preencode)
+    {
+        strip->items = heap_caps_malloc(strip->length * COLOR_SIZE(strip) * 8 * sizeof(rmt_item32_t),
+                                        MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!strip->items || init_byte_items(strip->type) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Not enough memory");
+            res = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+    }
 
     rmt_config_t config = RMT_DEFAULT_CONFIG_TX(strip->gpio, strip->channel);
     config.clk_div = LED_STRIP_RMT_CLK_DIV;
 
-    CHECK(rmt_config(&config));
-    CHECK(rmt_driver_install(config.channel, 0, 0));
+    if ((res = rmt_config(&config)) != ESP_OK)
+        goto fail;
+    if ((res = rmt_driver_install(config.channel, 0, 0)) != ESP_OK)
+        goto fail;
+    installed = true;
 
-    CHECK(rmt_translator_init(config.channel, led_params[strip->type].adapter));
+    if ((res = rmt_translator_init(config.channel, led_params[strip->type].adapter)) != ESP_OK)
+        goto fail;
 #ifdef LED_STRIP_BRIGHTNESS
     // No support for translator context prior to ESP-IDF 4.3
-    CHECK(rmt_translator_set_context(config.channel, strip));
+    if ((res = rmt_translator_set_context(config.channel, strip)) != ESP_OK)
+        goto fail;
 #endif
 
     return ESP_OK;
+
+fail:
+    if (installed)
+        rmt_driver_uninstall(strip->channel);
+    free(strip->buf);
+    strip->buf = NULL;
+    heap_caps_free(strip->items);
+    strip->items = NULL;
+    return res;
 }
 
 esp_err_t led_strip_free(led_strip_t *strip)
 {
     CHECK_ARG(strip && strip->buf);
     free(strip->buf);
+    strip->buf = NULL;
+    heap_caps_free(strip->items);
+    strip->items = NULL;
 
     CHECK(rmt_driver_uninstall(strip->channel));
 
     return ESP_OK;
 }
 
-esp_err_t led_strip_flush(led_strip_t *strip)
+static esp_err_t start(led_strip_t *strip, size_t len)
 {
-    CHECK_ARG(strip && strip->buf);
+    if (strip->items)
+    {
+        encode(strip, len);
+        CHECK(rmt_write_items(strip->channel, strip->items, len * COLOR_SIZE(strip) * 8, false));
+    }
+    else
+        CHECK(rmt_write_sample(strip->channel, strip->buf, len * COLOR_SIZE(strip), false));
+    strip->dirty = 0;
+#ifdef LED_STRIP_BRIGHTNESS
+    strip->frame++;
+#endif
+    return ESP_OK;
+}
 
+static esp_err_t flush(led_strip_t *strip, size_t len)
+{
     CHECK(rmt_wait_tx_done(strip->channel, pdMS_TO_TICKS(CONFIG_LED_STRIP_FLUSH_TIMEOUT)));
     ets_delay_us(CONFIG_LED_STRIP_PAUSE_LENGTH);
-    return rmt_write_sample(strip->channel, strip->buf,
-                            strip->length * COLOR_SIZE(strip), false);
+    return start(strip, len);
+}
+
+esp_err_t led_strip_flush(led_strip_t *strip)
+{
+    CHECK_ARG(strip && strip->buf);
+
+    return flush(strip, strip->length);
+}
+
+esp_err_t led_strip_flush_dirty(led_strip_t *strip)
+{
+    CHECK_ARG(strip && strip->buf);
+
+    if (!strip->dirty)
+        return ESP_OK;
+    return flush(strip, strip->dirty);
 }
 
 bool led_strip_busy(led_strip_t *strip)
@@ -238,10 +388,91 @@ esp_err_t led_strip_wait(led_strip_t *strip, TickType_t timeout)
     return rmt_wait_tx_done(strip->channel, timeout);
 }
 
+esp_err_t led_strip_group_init(led_strip_group_t *group, led_strip_t **strips, size_t count)
+{
+    CHECK_ARG(group && strips && count);
+    for (size_t i = 0; i < count; i++)
+        CHECK_ARG(strips[i] && strips[i]->buf);
+
+    group->strips = strips;
+    group->count = count;
+    group->started = 0;
+    group->period_us = 0;
+
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    for (size_t i = 0; i < count; i++)
+        CHECK(rmt_add_channel_to_group(strips[i]->channel));
+#endif
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_group_free(led_strip_group_t *group)
+{
+    CHECK_ARG(group && group->strips);
+
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    for (size_t i = 0; i < group->count; i++)
+        CHECK(rmt_remove_channel_from_group(group->strips[i]->channel));
+#endif
+    group->strips = NULL;
+    group->count = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_group_flush(led_strip_group_t *group)
+{
+    CHECK_ARG(group && group->strips);
+
+    CHECK(led_strip_group_wait(group, pdMS_TO_TICKS(CONFIG_LED_STRIP_FLUSH_TIMEOUT)));
+    // one pause for all strips
+    ets_delay_us(CONFIG_LED_STRIP_PAUSE_LENGTH);
+
+    // completion of RMT transmission is not timestamped, so the frame
+    // clock is measured between starts
+    int64_t now = esp_timer_get_time();
+    if (group->started)
+        group->period_us = now - group->started;
+    group->started = now;
+    for (size_t i = 0; i < group->count; i++)
+    {
+        esp_err_t res = start(group->strips[i], group->strips[i]->length);
+        if (res == ESP_OK)
+            continue;
+        // channels started so far would wait forever for the rest of the
+        // synchronized group, abort them
+        for (size_t j = 0; j < i; j++)
+        {
+            rmt_tx_stop(group->strips[j]->channel);
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+            rmt_remove_channel_from_group(group->strips[j]->channel);
+            rmt_add_channel_to_group(group->strips[j]->channel);
+#endif
+        }
+        group->started = 0;
+        return res;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_group_wait(led_strip_group_t *group, TickType_t timeout)
+{
+    CHECK_ARG(group && group->strips);
+
+    for (size_t i = 0; i < group->count; i++)
+        CHECK(rmt_wait_tx_done(group->strips[i]->channel, timeout));
+
+    return ESP_OK;
+}
+
 esp_err_t led_strip_set_pixel(led_strip_t *strip, size_t num, rgb_t color)
 {
-    CHECK_ARG(strip && strip->buf && num <= strip->length);
+    CHECK_ARG(strip && strip->buf && num < strip->length);
     size_t idx = num * COLOR_SIZE(strip);
+    if (num >= strip->dirty)
+        strip->dirty = num + 1;
     switch (led_params[strip->type].order)
     {
         case ORDER_GRB:
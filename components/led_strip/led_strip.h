@@ -68,16 +68,38 @@ typedef struct
 {
     led_strip_type_t type; ///< LED type
     bool is_rgbw;          ///< true for RGBW strips
+    bool preencode;        ///< Expand whole frame into RMT items before sending instead of
+                           ///< translating it on the fly in RMT interrupt. Takes 32 bytes
+                           ///< of internal RAM per color byte, but removes translation from
+                           ///< interrupt handler and allows longer strips without glitches.
 #ifdef LED_STRIP_BRIGHTNESS
     uint8_t brightness;    ///< Brightness 0..255, call ::led_strip_flush() after change.
                            ///< Supported only for ESP-IDF version >= 4.3
+    const color_correction_t *correction; ///< Color correction applied on the fly while sending,
+                           ///< NULL to disable. White channel of RGBW strips is not corrected.
+                           ///< Supported only for ESP-IDF version >= 4.3
+    uint8_t frame;         ///< Frame counter for temporal dithering, incremented on each flush
 #endif
     size_t length;         ///< Number of LEDs in strip
     gpio_num_t gpio;       ///< Data GPIO pin
     rmt_channel_t channel; ///< RMT channel
     uint8_t *buf;
+    size_t dirty;          ///< Number of leading LEDs covering all changes since last flush
+    rmt_item32_t *items;   ///< Encoded frame when `preencode` is set
+    uint32_t encode_us;    ///< CPU time of the last frame encoding when `preencode` is set, us
 } led_strip_t;
 
+/**
+ * Group of LED strips sharing one frame clock
+ */
+typedef struct
+{
+    led_strip_t **strips;  ///< Strips of the group
+    size_t count;          ///< Number of strips
+    int64_t started;       ///< Start time of the last frame, us since boot
+    uint32_t period_us;    ///< Time between starts of the last two frames, us
+} led_strip_group_t;
+
 /**
  * @brief Setup library
  *
@@ -109,6 +131,19 @@ esp_err_t led_strip_free(led_strip_t *strip);
  */
 esp_err_t led_strip_flush(led_strip_t *strip);
 
+/**
+ * @brief Send only changed part of strip buffer to LEDs
+ *
+ * LEDs of the chain which receive no data keep their colors, so only
+ * the pixels up to the last one changed since the previous flush are
+ * sent. Nothing is sent if the buffer has not been changed.
+ * Use ::led_strip_flush() after changing brightness.
+ *
+ * @param strip Descriptor of LED strip
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_flush_dirty(led_strip_t *strip);
+
 /**
  * @brief Check if associated RMT channel is busy
  *
@@ -126,6 +161,54 @@ bool led_strip_busy(led_strip_t *strip);
  */
 esp_err_t led_strip_wait(led_strip_t *strip, TickType_t timeout);
 
+/**
+ * @brief Initialize group of LED strips for parallel output
+ *
+ * All strips must be initialized with ::led_strip_init() and use different
+ * RMT channels. On chips supporting RMT TX synchronization the channels are
+ * started simultaneously, otherwise they are started one after another
+ * without waiting, so the frame time is the time of the longest strip in
+ * both cases.
+ *
+ * @param group Group descriptor
+ * @param strips Array of pointers to strip descriptors, must stay valid
+ *               while group is used
+ * @param count Number of strips
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_group_init(led_strip_group_t *group, led_strip_t **strips, size_t count);
+
+/**
+ * @brief Release group of LED strips
+ *
+ * Strips themselves are not freed.
+ *
+ * @param group Group descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_group_free(led_strip_group_t *group);
+
+/**
+ * @brief Send buffers of all strips of the group to LEDs
+ *
+ * Function waits until the previous frame is sent on every strip, then
+ * starts all strips at once and returns without waiting. Updates
+ * `period_us` field of the group descriptor.
+ *
+ * @param group Group descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_group_flush(led_strip_group_t *group);
+
+/**
+ * @brief Wait until all strips of the group are sent
+ *
+ * @param group Group descriptor
+ * @param timeout Timeout in RTOS ticks for each strip
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_group_wait(led_strip_group_t *group, TickType_t timeout);
+
 /**
  * @brief Set color of single LED in strip
  *
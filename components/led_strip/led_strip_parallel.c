@@ -0,0 +1,250 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file led_strip_parallel.c
+ *
+ * Parallel output of up to 16 WS2812B/SK6812 LED strips through
+ * LCD (I80) peripheral
+ *
+ * Copyright (c) 2020 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include "led_strip_parallel.h"
+
+#ifdef LED_STRIP_PARALLEL
+
+#include <string.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+
+static const char *TAG = "led_strip_parallel";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+// 400 ns per LCD clock, three clocks per bit
+#define PCLK_HZ 2500000
+#define SLOTS_PER_BIT 3
+#define SLOTS_PER_PIXEL (24 * SLOTS_PER_BIT)
+// low slots lasting at least the pause, rounded up for any pixel clock
+#define RESET_SLOTS ((size_t)(((uint64_t)CONFIG_LED_STRIP_PAUSE_LENGTH * PCLK_HZ + 999999) / 1000000))
+
+#define BUS_WIDTH(par) ((par)->lanes > 8 ? 16 : 8)
+
+static bool IRAM_ATTR trans_done(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t *edata, void *ctx)
+{
+    led_strip_parallel_t *par = (led_strip_parallel_t *)ctx;
+    BaseType_t woken = pdFALSE;
+
+    par->frame_us = esp_timer_get_time() - par->started;
+    xSemaphoreGiveFromISR(par->done, &woken);
+
+    return woken == pdTRUE;
+}
+
+// Only the middle (data) slot of each bit depends on colors, the first one
+// is high on all lanes and the last one is low, they are filled once.
+static void encode(led_strip_parallel_t *par)
+{
+    bool wide = BUS_WIDTH(par) == 16;
+    size_t stride = par->length * 3;
+    size_t slot = 1;
+
+    for (size_t i = 0; i < stride; i++)
+    {
+        // transpose i-th byte of all lanes into 8 bus words
+        uint16_t bits[8] = { 0 };
+        const uint8_t *src = par->buf + i;
+        for (size_t lane = 0; lane < par->lanes; lane++, src += stride)
+        {
+            uint8_t b = par->brightness == 255 ? *src : scale8_video(*src, par->brightness);
+            for (int bit = 0; bit < 8; bit++)
+                bits[bit] |= ((b >> (7 - bit)) & 1) << lane;
+        }
+        for (int bit = 0; bit < 8; bit++, slot += SLOTS_PER_BIT)
+        {
+            if (wide)
+                ((uint16_t *)par->dma_buf)[slot] = bits[bit];
+            else
+                par->dma_buf[slot] = bits[bit];
+        }
+    }
+}
+
+static void init_frame(led_strip_parallel_t *par)
+{
+    size_t bits = par->length * 24;
+    uint16_t mask = (1 << par->lanes) - 1;
+
+    if (BUS_WIDTH(par) == 8)
+        for (size_t i = 0; i < bits; i++)
+            par->dma_buf[i * SLOTS_PER_BIT] = mask;
+    else
+        for (size_t i = 0; i < bits; i++)
+            ((uint16_t *)par->dma_buf)[i * SLOTS_PER_BIT] = mask;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t led_strip_parallel_init(led_strip_parallel_t *par)
+{
+    CHECK_ARG(par && par->length && par->lanes && par->lanes <= LED_STRIP_PARALLEL_MAX_LANES
+              && (par->type == LED_STRIP_WS2812 || par->type == LED_STRIP_SK6812));
+
+    size_t width = BUS_WIDTH(par);
+    par->dma_size = (par->length * SLOTS_PER_PIXEL + RESET_SLOTS) * (width / 8);
+    par->buf = calloc(par->lanes, par->length * 3);
+    par->dma_buf = heap_caps_calloc(1, par->dma_size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    par->done = xSemaphoreCreateBinary();
+    if (!par->buf || !par->dma_buf || !par->done)
+    {
+        ESP_LOGE(TAG, "Not enough memory");
+        led_strip_parallel_free(par);
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(par->done);
+    init_frame(par);
+    par->frame_us = 0;
+
+    esp_lcd_i80_bus_config_t bus_config = {
+        .clk_src = LCD_CLK_SRC_DEFAULT,
+        .dc_gpio_num = -1,
+        .wr_gpio_num = par->clk_gpio,
+        .bus_width = width,
+        .max_transfer_bytes = par->dma_size,
+        .sram_trans_align = 4,
+    };
+    for (size_t i = 0; i < width; i++)
+        bus_config.data_gpio_nums[i] = par->gpio[i];
+    esp_err_t res = esp_lcd_new_i80_bus(&bus_config, &par->bus);
+    if (res != ESP_OK)
+    {
+        led_strip_parallel_free(par);
+        return res;
+    }
+
+    esp_lcd_panel_io_i80_config_t io_config = {
+        .cs_gpio_num = -1,
+        .pclk_hz = PCLK_HZ,
+        .trans_queue_depth = 1,
+        .on_color_trans_done = trans_done,
+        .user_ctx = par,
+        .lcd_cmd_bits = 8,
+        .lcd_param_bits = 8,
+    };
+    res = esp_lcd_new_panel_io_i80(par->bus, &io_config, &par->io);
+    if (res != ESP_OK)
+    {
+        led_strip_parallel_free(par);
+        return res;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_parallel_free(led_strip_parallel_t *par)
+{
+    CHECK_ARG(par);
+
+    if (par->io)
+    {
+        xSemaphoreTake(par->done, pdMS_TO_TICKS(CONFIG_LED_STRIP_FLUSH_TIMEOUT));
+        esp_lcd_panel_io_del(par->io);
+        par->io = NULL;
+    }
+    if (par->bus)
+    {
+        esp_lcd_del_i80_bus(par->bus);
+        par->bus = NULL;
+    }
+    if (par->done)
+    {
+        vSemaphoreDelete(par->done);
+        par->done = NULL;
+    }
+    free(par->buf);
+    par->buf = NULL;
+    heap_caps_free(par->dma_buf);
+    par->dma_buf = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_parallel_flush(led_strip_parallel_t *par)
+{
+    CHECK_ARG(par && par->io);
+
+    // encoding into the buffer being sent is not allowed
+    if (xSemaphoreTake(par->done, pdMS_TO_TICKS(CONFIG_LED_STRIP_FLUSH_TIMEOUT)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    encode(par);
+
+    // reset pause is at the end of DMA buffer
+    par->started = esp_timer_get_time();
+    esp_err_t res = esp_lcd_panel_io_tx_color(par->io, -1, par->dma_buf, par->dma_size);
+    if (res != ESP_OK)
+        xSemaphoreGive(par->done);
+
+    return res;
+}
+
+esp_err_t led_strip_parallel_wait(led_strip_parallel_t *par, TickType_t timeout)
+{
+    CHECK_ARG(par && par->done);
+
+    if (xSemaphoreTake(par->done, timeout) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+    xSemaphoreGive(par->done);
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_parallel_set_pixel(led_strip_parallel_t *par, size_t lane, size_t num, rgb_t color)
+{
+    CHECK_ARG(par && par->buf && lane < par->lanes && num < par->length);
+
+    uint8_t *p = par->buf + (lane * par->length + num) * 3;
+    p[0] = color.g;
+    p[1] = color.r;
+    p[2] = color.b;
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_parallel_set_pixels(led_strip_parallel_t *par, size_t lane, size_t start, size_t len, rgb_t *data)
+{
+    CHECK_ARG(par && par->buf && data && len && lane < par->lanes && start + len <= par->length);
+
+    for (size_t i = 0; i < len; i++)
+        CHECK(led_strip_parallel_set_pixel(par, lane, start + i, data[i]));
+
+    return ESP_OK;
+}
+
+#endif /* LED_STRIP_PARALLEL */
@@ -0,0 +1,161 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file led_strip_parallel.h
+ * @defgroup led_strip_parallel led_strip_parallel
+ * @{
+ *
+ * Parallel output of up to 16 WS2812B/SK6812 LED strips through
+ * LCD (I80) peripheral
+ *
+ * Frames of all strips are encoded into one DMA buffer, each bit of each
+ * data line is three LCD clock periods of 400 ns (high, data, low), so the
+ * frame time equals the time of the longest strip.
+ *
+ * Copyright (c) 2020 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __LED_STRIP_PARALLEL_H__
+#define __LED_STRIP_PARALLEL_H__
+
+#include <esp_idf_version.h>
+#include <soc/soc_caps.h>
+#include "led_strip.h"
+
+#if SOC_LCD_I80_SUPPORTED && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+
+#define LED_STRIP_PARALLEL 1
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_lcd_panel_io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Maximum number of strips
+ */
+#define LED_STRIP_PARALLEL_MAX_LANES 16
+
+/**
+ * Parallel LED strips descriptor
+ */
+typedef struct
+{
+    led_strip_type_t type;   ///< LED type, only ::LED_STRIP_WS2812 and ::LED_STRIP_SK6812 are supported
+    size_t lanes;            ///< Number of strips, 1..16
+    size_t length;           ///< Number of LEDs in each strip
+    gpio_num_t gpio[LED_STRIP_PARALLEL_MAX_LANES]; ///< Data GPIO pins. Bus is 8 lines wide for up to
+                             ///< 8 strips and 16 lines otherwise, pins must be given for all lines
+                             ///< of the bus, lines above `lanes` are kept low
+    gpio_num_t clk_gpio;     ///< LCD clock output required by peripheral, not connected to LEDs
+    uint8_t brightness;      ///< Brightness 0..255, applied while encoding frame
+    uint32_t frame_us;       ///< Duration of the last sent frame, us
+
+    uint8_t *buf;            ///< Colors, `length` GRB triplets for each strip
+    uint8_t *dma_buf;        ///< Encoded frame
+    size_t dma_size;         ///< Encoded frame size, bytes
+    esp_lcd_i80_bus_handle_t bus;
+    esp_lcd_panel_io_handle_t io;
+    SemaphoreHandle_t done;
+    int64_t started;
+} led_strip_parallel_t;
+
+/**
+ * @brief Initialize parallel LED strips, LCD peripheral and allocate buffers
+ *
+ * Fields `type`, `lanes`, `length`, `gpio`, `clk_gpio` and `brightness`
+ * must be set before calling this function.
+ *
+ * @param par Descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_parallel_init(led_strip_parallel_t *par);
+
+/**
+ * @brief Release LCD peripheral and free buffers
+ *
+ * @param par Descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_parallel_free(led_strip_parallel_t *par);
+
+/**
+ * @brief Encode colors of all strips and send them to LEDs
+ *
+ * Function waits until the previous frame is sent, then starts DMA
+ * transfer and returns without waiting.
+ *
+ * @param par Descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_parallel_flush(led_strip_parallel_t *par);
+
+/**
+ * @brief Wait until frame is sent
+ *
+ * @param par Descriptor
+ * @param timeout Timeout in RTOS ticks
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_parallel_wait(led_strip_parallel_t *par, TickType_t timeout);
+
+/**
+ * @brief Set color of single LED
+ *
+ * This function does not actually change colors of the LEDs.
+ * Call ::led_strip_parallel_flush() to send buffer to the LEDs.
+ *
+ * @param par Descriptor
+ * @param lane Strip number, 0..lanes - 1
+ * @param num LED number, 0..length - 1
+ * @param color RGB color
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_parallel_set_pixel(led_strip_parallel_t *par, size_t lane, size_t num, rgb_t color);
+
+/**
+ * @brief Set colors of multiple LEDs of one strip
+ *
+ * @param par Descriptor
+ * @param lane Strip number, 0..lanes - 1
+ * @param start First LED index, 0-based
+ * @param len Number of LEDs
+ * @param data Pointer to RGB data
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_parallel_set_pixels(led_strip_parallel_t *par, size_t lane, size_t start, size_t len, rgb_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOC_LCD_I80_SUPPORTED */
+
+/**@}*/
+
+#endif /* __LED_STRIP_PARALLEL_H__ */
@@ -45,6 +45,7 @@
 
 #if HELPER_TARGET_IS_ESP32
 #include <driver/spi_master.h>
+#include <esp_timer.h>
 #elif HELPER_TARGET_IS_ESP8266
 #include <driver/spi.h>
 #endif
@@ -114,6 +115,19 @@ static esp_err_t led_strip_spi_init_esp32(led_strip_spi_t *strip)
         goto fail;
     }
     memset(strip->buf, 0, LED_STRIP_SPI_BUFFER_SIZE(strip->length));
+    strip->dirty = strip->length;
+    strip->bufs[0] = strip->buf;
+    strip->bufs[1] = NULL;
+    strip->pending = false;
+    strip->flushed_at = 0;
+    if (strip->pipelined) {
+        strip->bufs[1] = heap_caps_malloc(LED_STRIP_SPI_BUFFER_SIZE(strip->length), MALLOC_CAP_DMA | MALLOC_CAP_32BIT);
+        if (strip->bufs[1] == NULL) {
+            ESP_LOGE(TAG, "heap_caps_malloc()");
+            err = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+    }
 
     /* XXX length is in bit */
     strip->transaction.length = LED_STRIP_SPI_BUFFER_SIZE(strip->length) * 8;
@@ -126,6 +140,9 @@ static esp_err_t led_strip_spi_init_esp32(led_strip_spi_t *strip)
         goto fail;
     }
 #endif
+    if (strip->pipelined) {
+        memcpy(strip->bufs[1], strip->buf, LED_STRIP_SPI_BUFFER_SIZE(strip->length));
+    }
     ESP_LOGD(TAG, "SPI buffer initialized");
 
     err = spi_bus_initialize(strip->host_device, &bus_config, strip->dma_chan);
@@ -183,6 +200,7 @@ static esp_err_t led_strip_spi_init_esp8266(led_strip_spi_t *strip)
         goto fail;
     }
     memset(strip->buf, 0, LED_STRIP_SPI_BUFFER_SIZE(strip->length));
+    strip->dirty = strip->length;
 
 #if CONFIG_LED_STRIP_SPI_USING_SK9822
     err = led_strip_spi_sk9822_buf_init(strip);
@@ -228,21 +246,78 @@ esp_err_t led_strip_spi_free(led_strip_spi_t *strip)
 {
     CHECK_ARG(strip);
 
+#if HELPER_TARGET_IS_ESP32
+    CHECK(led_strip_spi_wait(strip));
+    if (strip->pipelined) {
+        free(strip->bufs[0]);
+        free(strip->bufs[1]);
+        strip->bufs[0] = strip->bufs[1] = strip->buf = NULL;
+        return ESP_OK;
+    }
+#endif
     free(strip->buf);
     return ESP_OK;
 }
 
 #if HELPER_TARGET_IS_ESP32
-static esp_err_t led_strip_spi_flush_esp32(led_strip_spi_t *strip)
+static esp_err_t led_strip_spi_wait_esp32(led_strip_spi_t *strip)
 {
-    esp_err_t err = ESP_FAIL;
+    esp_err_t err;
     spi_transaction_t* t;
 
-    CHECK_ARG(strip);
-    if (!strip->transaction.tx_buffer) {
-        strip->transaction.tx_buffer = strip->buf;
+    if (!strip->pending) {
+        return ESP_OK;
+    }
+    err = spi_device_get_trans_result(strip->device_handle, &t, portMAX_DELAY);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "spi_device_get_trans_result(): %s", esp_err_to_name(err));
+        return err;
+    }
+    strip->pending = false;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_flush_pipelined_esp32(led_strip_spi_t *strip)
+{
+    esp_err_t err;
+    size_t size = LED_STRIP_SPI_BUFFER_SIZE(strip->length);
+    int64_t start = esp_timer_get_time();
+
+    /* the only blocking point: transaction of the previous frame must be
+     * finished before its buffer is reused for drawing */
+    CHECK(led_strip_spi_wait_esp32(strip));
+    int64_t now = esp_timer_get_time();
+    strip->wait_us = now - start;
+    if (strip->flushed_at) {
+        strip->frame_us = now - strip->flushed_at;
     }
+    strip->flushed_at = now;
+
     strip->transaction.tx_buffer = strip->buf;
+    /* XXX length is in bit */
+    strip->transaction.length = size * 8;
+    err = spi_device_queue_trans(strip->device_handle, &strip->transaction, portMAX_DELAY);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "spi_device_queue_trans(): %s", esp_err_to_name(err));
+        return err;
+    }
+    strip->pending = true;
+
+    /* continue drawing on a copy of the queued frame, DMA only reads it */
+    void *next = strip->buf == strip->bufs[0] ? strip->bufs[1] : strip->bufs[0];
+    memcpy(next, strip->buf, size);
+    strip->buf = next;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_transmit_esp32(led_strip_spi_t *strip, const void *data, size_t size)
+{
+    esp_err_t err = ESP_FAIL;
+    spi_transaction_t* t;
+
+    strip->transaction.tx_buffer = data;
+    /* XXX length is in bit */
+    strip->transaction.length = size * 8;
     err = spi_device_queue_trans(strip->device_handle, &strip->transaction, portMAX_DELAY);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "spi_device_queue_trans(): %s", esp_err_to_name(err));
@@ -263,20 +338,18 @@ fail:
 
 #define ESP8266_SPI_MAX_DATA_LENGTH 64 // in bytes
 
-static esp_err_t led_strip_spi_flush_esp8266(led_strip_spi_t *strip)
+static esp_err_t led_strip_spi_transmit_esp8266(led_strip_spi_t *strip, const void *data, size_t size)
 {
     esp_err_t err = ESP_FAIL;
     spi_trans_t trans = {0};
     int mosi_buffer_block_size, mosi_buffer_block_size_mod;
 
-    CHECK_ARG(strip);
-
     /* XXX send ESP8266_SPI_MAX_DATA_LENGTH bytes data at a time. the
      * documentation does not mention the limitation, but the SPI master
      * driver complains:
      * "spi: spi_master_trans(454): spi mosi must be shorter than 512 bits" */
-    mosi_buffer_block_size = LED_STRIP_SPI_BUFFER_SIZE(strip->length) / ESP8266_SPI_MAX_DATA_LENGTH;
-    mosi_buffer_block_size_mod = LED_STRIP_SPI_BUFFER_SIZE(strip->length) % ESP8266_SPI_MAX_DATA_LENGTH;
+    mosi_buffer_block_size = size / ESP8266_SPI_MAX_DATA_LENGTH;
+    mosi_buffer_block_size_mod = size % ESP8266_SPI_MAX_DATA_LENGTH;
 
     if (xSemaphoreTake(mutex, MUTEX_TIMEOUT) != pdTRUE) {
         err = ESP_FAIL;
@@ -286,7 +359,7 @@ static esp_err_t led_strip_spi_flush_esp8266(led_strip_spi_t *strip)
 
     for (int i = 0; i < mosi_buffer_block_size; i++) {
         trans.bits.mosi = ESP8266_SPI_MAX_DATA_LENGTH * 8; // bits, not bytes
-        trans.mosi = strip->buf + ESP8266_SPI_MAX_DATA_LENGTH * i;
+        trans.mosi = (uint32_t *)((uint8_t *)data + ESP8266_SPI_MAX_DATA_LENGTH * i);
         err = spi_trans(HSPI_HOST, &trans);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "spi_trans(): %s", esp_err_to_name(err));
@@ -295,7 +368,7 @@ static esp_err_t led_strip_spi_flush_esp8266(led_strip_spi_t *strip)
     }
     if (mosi_buffer_block_size_mod > 0) {
         trans.bits.mosi = mosi_buffer_block_size_mod * 8; // bits, not bytes
-        trans.mosi = strip->buf + ESP8266_SPI_MAX_DATA_LENGTH * mosi_buffer_block_size;
+        trans.mosi = (uint32_t *)((uint8_t *)data + ESP8266_SPI_MAX_DATA_LENGTH * mosi_buffer_block_size);
         err = spi_trans(HSPI_HOST, &trans);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "spi_trans(): %s", esp_err_to_name(err));
@@ -310,17 +383,71 @@ fail_without_give:
     return err;
 }
 #endif
-esp_err_t led_strip_spi_flush(led_strip_spi_t*strip)
+static esp_err_t led_strip_spi_transmit(led_strip_spi_t *strip, const void *data, size_t size)
 {
 #if HELPER_TARGET_IS_ESP32
-    return led_strip_spi_flush_esp32(strip);
+    return led_strip_spi_transmit_esp32(strip, data, size);
 #elif HELPER_TARGET_IS_ESP8266
-    return led_strip_spi_flush_esp8266(strip);
+    return led_strip_spi_transmit_esp8266(strip, data, size);
 #else
 #error "Unknown target"
 #endif
 }
 
+esp_err_t led_strip_spi_wait(led_strip_spi_t*strip)
+{
+    CHECK_ARG(strip);
+
+#if HELPER_TARGET_IS_ESP32
+    return led_strip_spi_wait_esp32(strip);
+#else
+    return ESP_OK;
+#endif
+}
+
+esp_err_t led_strip_spi_flush(led_strip_spi_t*strip)
+{
+    CHECK_ARG(strip && strip->buf);
+
+#if HELPER_TARGET_IS_ESP32
+    if (strip->pipelined) {
+        CHECK(led_strip_spi_flush_pipelined_esp32(strip));
+        strip->dirty = 0;
+        return ESP_OK;
+    }
+#endif
+    CHECK(led_strip_spi_transmit(strip, strip->buf, LED_STRIP_SPI_BUFFER_SIZE(strip->length)));
+    strip->dirty = 0;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_spi_flush_dirty(led_strip_spi_t*strip)
+{
+    CHECK_ARG(strip && strip->buf);
+
+    if (!strip->dirty) {
+        return ESP_OK;
+    }
+    if (strip->dirty >= strip->length) {
+        return led_strip_spi_flush(strip);
+    }
+#if HELPER_TARGET_IS_ESP32
+    /* partial transfers would block, the whole frame is queued instead */
+    if (strip->pipelined) {
+        return led_strip_spi_flush(strip);
+    }
+#endif
+
+    /* start frame and LED frames up to the last changed one, then the
+     * frames following LED frames in the tail of the buffer */
+    size_t head = LED_STRIP_SPI_BUFFER_HEAD_SIZE(strip->dirty);
+    size_t leds = LED_STRIP_SPI_BUFFER_HEAD_SIZE(strip->length);
+    CHECK(led_strip_spi_transmit(strip, strip->buf, head));
+    CHECK(led_strip_spi_transmit(strip, (uint8_t *)strip->buf + leds, LED_STRIP_SPI_BUFFER_SIZE(strip->length) - leds));
+    strip->dirty = 0;
+    return ESP_OK;
+}
+
 esp_err_t led_strip_spi_set_pixel(led_strip_spi_t *strip, const int index, const rgb_t color)
 {
     return led_strip_spi_set_pixel_brightness(strip, index, color, LED_STRIP_SPI_MAX_BRIGHTNESS);
@@ -338,8 +465,18 @@ esp_err_t led_strip_spi_fill(led_strip_spi_t*strip, size_t start, size_t len, rg
 
 esp_err_t led_strip_spi_set_pixel_brightness(led_strip_spi_t *strip, const int index, const rgb_t color, const uint8_t brightness)
 {
+    rgb_t c = color;
+
+    /* pixels are written to the DMA buffer directly, so correction is
+     * applied here, without temporal dithering even if it is enabled */
+    if (strip->correction) {
+        const color_correction_t *cc = strip->correction;
+        c.r = color_correction_channel(cc, 0, color.r, COLOR_CORRECTION_NO_DITHER);
+        c.g = color_correction_channel(cc, 1, color.g, COLOR_CORRECTION_NO_DITHER);
+        c.b = color_correction_channel(cc, 2, color.b, COLOR_CORRECTION_NO_DITHER);
+    }
 #if CONFIG_LED_STRIP_SPI_USING_SK9822
-    return led_strip_spi_set_pixel_sk9822(strip, index, color, brightness);
+    return led_strip_spi_set_pixel_sk9822(strip, index, c, brightness);
 #endif
     return ESP_ERR_NOT_SUPPORTED;
 }
@@ -368,3 +505,16 @@ esp_err_t led_strip_spi_fill_brightness(led_strip_spi_t*strip, size_t start, siz
     }
     return ESP_OK;
 }
+
+esp_err_t led_strip_spi_set_pixels_hdr(led_strip_spi_t*strip, size_t start, size_t len, const led_strip_spi_rgb16_t *data)
+{
+    CHECK_ARG(strip && strip->buf && data && len && start + len <= strip->length);
+
+#if CONFIG_LED_STRIP_SPI_USING_SK9822
+    for (size_t i = 0; i < len; i++) {
+        CHECK(led_strip_spi_set_pixel_hdr_sk9822(strip, start + i, data[i]));
+    }
+    return ESP_OK;
+#endif
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -56,10 +56,22 @@ typedef led_strip_spi_esp8266_t led_strip_spi_t;
 extern "C" {
 #endif
 
+/**
+ * RGB color with 16 bits per channel
+ */
+typedef struct {
+    uint16_t r; ///< Red
+    uint16_t g; ///< Green
+    uint16_t b; ///< Blue
+} led_strip_spi_rgb16_t;
+
 /*
  * * add LED_STRIP_SPI_USING_$NAME to Kconfig
  * * define `LED_STRIP_SPI_BUFFER_SIZE(N_PIXEL)` that returns the required
  *   size of buffer for the $NAME.
+ * * define `LED_STRIP_SPI_BUFFER_HEAD_SIZE(N_PIXEL)` that returns the size
+ *   of the leading part of buffer up to and including the LED frame of
+ *   pixel `N_PIXEL - 1`.
  */
 
 #if defined(CONFIG_LED_STRIP_SPI_USING_SK9822)
@@ -99,11 +111,46 @@ esp_err_t led_strip_spi_free(led_strip_spi_t *strip);
 
 /**
  * @brief Send strip buffer to LEDs
+ *
+ * In pipelined mode function only waits for the previous frame to be sent,
+ * queues the buffer and switches `buf` to the second buffer holding a copy
+ * of the frame, so the next frame can be drawn while this one is on the wire.
+ * Time between flushes and time spent waiting are kept in `frame_us` and
+ * `wait_us`, the share of frame time the caller was not blocked is
+ * `1 - wait_us / frame_us`.
+ *
  * @param strip Descriptor of LED strip
  * @return `ESP_OK` on success
  */
 esp_err_t led_strip_spi_flush(led_strip_spi_t*strip);
 
+/**
+ * @brief Wait until the frame being transferred is sent
+ *
+ * Only useful in pipelined mode (ESP32 family, `pipelined` is set), where
+ * ::led_strip_spi_flush() returns right after queueing the transfer, e.g.
+ * before changing SPI bus or freeing the strip. Several strips on separate
+ * SPI hosts are sent concurrently if they are flushed one after another
+ * and waited for afterwards.
+ *
+ * @param strip Descriptor of LED strip
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_spi_wait(led_strip_spi_t*strip);
+
+/**
+ * @brief Send only changed part of strip buffer to LEDs
+ *
+ * LED frames are sent up to the last pixel changed since the previous
+ * flush, followed by the reset and end frames. LEDs which receive no
+ * data keep their colors. Nothing is sent if the buffer has not been
+ * changed.
+ *
+ * @param strip Descriptor of LED strip
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_spi_flush_dirty(led_strip_spi_t*strip);
+
 /**
  * @brief Set color of single LED in strip.
  *
@@ -188,6 +235,25 @@ esp_err_t led_strip_spi_fill(led_strip_spi_t*strip, size_t start, size_t len, rg
  * @return `ESP_OK` on success
  */
 esp_err_t led_strip_spi_fill_brightness(led_strip_spi_t*strip, size_t start, size_t len, rgb_t color, const uint8_t brightness);
+
+/**
+ * @brief Set colors of multiple LEDs from 16 bit per channel data.
+ *
+ * Per-pixel current control of the LEDs is used to extend resolution of
+ * dim colors (SK9822, APA102), so fades are smooth without temporal
+ * dithering. Color correction of the strip is not applied, \p data must be
+ * already gamma corrected.
+ *
+ * This function does not actually change colors of the LEDs.
+ * Call ::led_strip_spi_flush() to send buffer to the LEDs.
+ *
+ * @param strip Descriptor of LED strip
+ * @param start First LED index, 0-based
+ * @param len Number of LEDs
+ * @param data Pointer to `len` colors
+ * @return `ESP_OK` on success
+ */
+esp_err_t led_strip_spi_set_pixels_hdr(led_strip_spi_t*strip, size_t start, size_t len, const led_strip_spi_rgb16_t *data);
 #ifdef __cplusplus
 }
 #endif
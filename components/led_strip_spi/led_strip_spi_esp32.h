@@ -34,6 +34,7 @@
 #include <esp_idf_lib_helpers.h>
 #include <esp_idf_version.h>
 #include <driver/spi_master.h>
+#include <color.h>
 
 #if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(4, 0, 0)
 #define LED_STRIP_SPI_DEFAULT_HOST_DEVICE  HSPI_HOST
@@ -72,6 +73,14 @@ typedef struct
     spi_device_handle_t device_handle;  ///< Device handle assigned by the driver. The caller must provdie this.
     int dma_chan;                       ///< DMA channed to use. Either 1 or 2.
     spi_transaction_t transaction;      ///< SPI transaction used internally by the driver.
+    size_t dirty;                       ///< Number of leading pixels covering all changes since last flush.
+    const color_correction_t *correction; ///< Color correction applied when pixels are set, NULL to disable.
+    bool pipelined;                     ///< Double buffering: flush returns as soon as the frame is queued and `buf` is switched to the second buffer.
+    void *bufs[2];                      ///< DMA buffers in pipelined mode, `buf` points to one of them.
+    bool pending;                       ///< Transaction is queued and its result is not received yet.
+    int64_t flushed_at;                 ///< Time of the last flush since boot, us.
+    uint32_t frame_us;                  ///< Time between the last two flushes, us.
+    uint32_t wait_us;                   ///< Time the last flush waited for the previous transfer, us.
 } led_strip_spi_esp32_t;
 
 /**
@@ -95,7 +104,8 @@ typedef struct
  * `clock_speed_hz`: 1000000,
  * `queue_size`: 1,
  * `device_handle`: `NULL`,
- * `dma_chan`: 1
+ * `dma_chan`: 1,
+ * `pipelined`: `false`
  */
 #define LED_STRIP_SPI_DEFAULT_ESP32() \
 { \
@@ -109,6 +119,7 @@ typedef struct
     .queue_size = 1,                                  \
     .device_handle = NULL,                            \
     .dma_chan = LED_STRIP_SPI_DEFAULT_DMA_CHAN,       \
+    .pipelined = false,                               \
 }
 
 /** @} */
@@ -33,6 +33,7 @@
  */
 
 #include <driver/spi.h>
+#include <color.h>
 #include "led_strip_spi_esp8266.h"
 
 /**
@@ -45,6 +46,8 @@ typedef struct
     void *buf;              ///< Pointer to the buffer.
     size_t length;          ///< Number of pixels.
     spi_clk_div_t clk_div;  ///< Value of `clk_div`, such as `SPI_2MHz_DIV`. See available values in `${IDF_PATH}/components/esp8266/include/driver/spi.h`.
+    size_t dirty;           ///< Number of leading pixels covering all changes since last flush.
+    const color_correction_t *correction; ///< Color correction applied when pixels are set, NULL to disable.
 } led_strip_spi_esp8266_t;
 
 /**
@@ -22,10 +22,41 @@
  * SOFTWARE.
  */
 
+#include <stdbool.h>
 #include <esp_err.h>
 #include "led_strip_spi.h"
 #include "led_strip_spi_sk9822.h"
 
+/* HDR decomposition tables:
+ * hdr_level[h] - lowest brightness field at which 8-bit PWM can represent
+ *                any value with high byte h,
+ * hdr_scale[l] - 8.24 factor converting 16-bit value to PWM at level l,
+ *                the product never exceeds 32 bits as value <= 65535 * l / 31 */
+static uint8_t hdr_level[256];
+static uint32_t hdr_scale[LED_STRIP_SPI_FRAME_SK9822_LED_MAX_BRIGHTNESS + 1];
+static bool hdr_ready;
+
+static void hdr_tables_init(void)
+{
+    const uint32_t max = LED_STRIP_SPI_FRAME_SK9822_LED_MAX_BRIGHTNESS;
+
+    for (uint32_t h = 0; h < 256; h++) {
+        uint32_t level = (((h << 8) | 0xff) * max + 0xfffe) / 0xffff;
+        hdr_level[h] = level ? level : 1;
+    }
+    for (uint32_t l = 1; l <= max; l++) {
+        /* value * max * 255 / (65535 * l) */
+        hdr_scale[l] = ((uint64_t)max * 255 * (1 << 24) + 65535 * l / 2) / (65535 * l);
+    }
+    hdr_ready = true;
+}
+
+static inline uint8_t hdr_pwm(uint16_t value, uint32_t scale)
+{
+    uint32_t v = (value * scale + 0x800000) >> 24;
+    return v > 255 ? 255 : v;
+}
+
 esp_err_t led_strip_spi_set_pixel_sk9822(led_strip_spi_t *strip, size_t num, rgb_t color, uint8_t brightness)
 {
     int index = (num + 1) * 4;
@@ -42,11 +73,38 @@ esp_err_t led_strip_spi_set_pixel_sk9822(led_strip_spi_t *strip, size_t num, rgb
     ((uint8_t *)strip->buf)[index + 1] = color.b;
     ((uint8_t *)strip->buf)[index + 2] = color.g;
     ((uint8_t *)strip->buf)[index + 3] = color.r;
+    if (num >= strip->dirty) {
+        strip->dirty = num + 1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_spi_set_pixel_hdr_sk9822(led_strip_spi_t *strip, size_t num, led_strip_spi_rgb16_t color)
+{
+    int index = (num + 1) * 4;
+    uint16_t max = color.r > color.g ? color.r : color.g;
+    if (color.b > max) {
+        max = color.b;
+    }
+    uint8_t level = hdr_level[max >> 8];
+    uint32_t scale = hdr_scale[level];
+
+    ((uint8_t *)strip->buf)[index    ] = LED_STRIP_SPI_FRAME_SK9822_LED_MSB3 | level;
+    ((uint8_t *)strip->buf)[index + 1] = hdr_pwm(color.b, scale);
+    ((uint8_t *)strip->buf)[index + 2] = hdr_pwm(color.g, scale);
+    ((uint8_t *)strip->buf)[index + 3] = hdr_pwm(color.r, scale);
+    if (num >= strip->dirty) {
+        strip->dirty = num + 1;
+    }
     return ESP_OK;
 }
 
 esp_err_t led_strip_spi_sk9822_buf_init(led_strip_spi_t *strip)
 {
+    if (!hdr_ready) {
+        hdr_tables_init();
+    }
+
     /* set mandatory bits in all LED frames */
     for (int i = 1; i <= strip->length; i++) {
         ((uint8_t *)strip->buf)[i * 4] = LED_STRIP_SPI_FRAME_SK9822_LED_MSB3;
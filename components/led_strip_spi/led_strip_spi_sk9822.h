@@ -48,6 +48,7 @@
 #if !defined(__LED_STRIP_SPI_SK9822_H__)
 #define __LED_STRIP_SPI_SK9822_H__
 
+#include <stdint.h>
 #include <esp_err.h>
 
 #ifdef __cplusplus
@@ -63,6 +64,7 @@ extern "C" {
 #define LED_STRIP_SPI_FRAME_SK9822_LED_MSB3    (0xE0)   ///< A magic number of [31:29] in LED frames. The bits must be 1 (APA102, SK9822)
 
 #define LED_STRIP_SPI_FRAME_SK9822_LED_BRIGHTNESS_BITS (5) ///< Number of bits used to describe the brightness of the LED
+#define LED_STRIP_SPI_FRAME_SK9822_LED_MAX_BRIGHTNESS  ((1 << LED_STRIP_SPI_FRAME_SK9822_LED_BRIGHTNESS_BITS) - 1) ///< Maximum value of the brightness field
 
 #define LED_STRIP_SPI_BUFFER_SIZE(N_PIXEL) (\
         LED_STRIP_SPI_FRAME_SK9822_START_SIZE + \
@@ -70,6 +72,10 @@ extern "C" {
         LED_STRIP_SPI_FRAME_SK9822_RESET_SIZE + \
         LED_STRIP_SPI_FRAME_SK9822_END_SIZE(N_PIXEL)) ///< A macro to caliculate required size of buffer. `N_PIXEL` is the number of pixels in the strip.
 
+#define LED_STRIP_SPI_BUFFER_HEAD_SIZE(N_PIXEL) (\
+        LED_STRIP_SPI_FRAME_SK9822_START_SIZE + \
+        LED_STRIP_SPI_FRAME_SK9822_LEDS_SIZE(N_PIXEL)) ///< Size of start frame and LED frames of first `N_PIXEL` pixels.
+
 /**
  * @brief Initialize the buffer of SK9822 strip.
  * @param[in] strip LED strip descriptor to initialize
@@ -87,6 +93,22 @@ esp_err_t led_strip_spi_sk9822_buf_init(led_strip_spi_t *strip);
  */
 esp_err_t led_strip_spi_set_pixel_sk9822(led_strip_spi_t *strip, size_t num, rgb_t color, uint8_t brightness);
 
+/**
+ * @brief Set color of a pixel of SK9822 strip with 16 bits per channel.
+ *
+ * The 5-bit brightness field of the LED frame is chosen per pixel as the
+ * lowest current which can still represent the brightest channel, the
+ * channels are then scaled to 8-bit PWM values for that current. So dim
+ * colors keep up to 13 bits of resolution. Both steps use lookup tables
+ * built by ::led_strip_spi_sk9822_buf_init().
+ *
+ * @param[in] strip LED strip descriptor.
+ * @param[in] num Index of the LED pixel (zero-based).
+ * @param[in] color The color to set, linear, 0-65535 per channel.
+ * @return `ESP_OK` on success.
+ */
+esp_err_t led_strip_spi_set_pixel_hdr_sk9822(led_strip_spi_t *strip, size_t num, led_strip_spi_rgb16_t color);
+
 #ifdef __cplusplus
 }
 #endif
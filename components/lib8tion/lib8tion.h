@@ -267,6 +267,7 @@ typedef union
 #include "lib8tion/scale8.h"
 #include "lib8tion/random8.h"
 #include "lib8tion/trig8.h"
+#include "lib8tion/fixed.h"
 
 ///////////////////////////////////////////////////////////////////////
 //
@@ -0,0 +1,164 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __INC_LIB8TION_FIXED_H
+#define __INC_LIB8TION_FIXED_H
+
+///@ingroup lib8tion
+
+///@defgroup Fixed Fixed point math
+/// Q16.16 (::saccum1516) arithmetic, table-based trigonometry and 2D
+/// vectors for effects which must not use FPU.
+///
+/// Angles are 16-bit, 65536 is a full turn, same as in sin16().
+///@{
+
+/// Convert integer to Q16.16
+#define FIXED_FROM_INT(i)   ((saccum1516)((int32_t)(i) * 65536))
+/// Convert float constant to Q16.16
+#define FIXED_FROM_FLOAT(f) ((saccum1516)((f) * 65536.0f))
+/// Integer part of Q16.16, rounded towards minus infinity
+#define FIXED_INT(v)        ((int32_t)(v) >> 16)
+/// Fractional part of Q16.16 as ::fract16
+#define FIXED_FRAC(v)       ((fract16)((v) & 0xffff))
+/// Q16.16 one
+#define FIXED_ONE           FIXED_FROM_INT(1)
+
+/// Quarter sine wave, `sin(i * pi / 512) * 65535`, 257 entries
+extern const uint16_t fixed_sin_table[257];
+/// Arctangent, `atan(i / 256)` in 16-bit angle units, 257 entries
+extern const uint16_t fixed_atan_table[257];
+
+/// Two-dimensional Q16.16 vector
+typedef struct
+{
+    saccum1516 x;
+    saccum1516 y;
+} vec2_1516_t;
+
+/// Multiply two Q16.16 values
+LIB8STATIC_ALWAYS_INLINE saccum1516 mul1516(saccum1516 a, saccum1516 b)
+{
+    return (saccum1516)(((int64_t)a * b) >> 16);
+}
+
+/// Divide two Q16.16 values, b must not be zero
+LIB8STATIC_ALWAYS_INLINE saccum1516 div1516(saccum1516 a, saccum1516 b)
+{
+    return (saccum1516)(((int64_t)a * 65536) / b);
+}
+
+/// Linear interpolation between two Q16.16 values
+LIB8STATIC_ALWAYS_INLINE saccum1516 lerp1516(saccum1516 a, saccum1516 b, fract16 frac)
+{
+    return a + (saccum1516)(((int64_t)(b - a) * frac) >> 16);
+}
+
+/// Sine of 16-bit angle as Q16.16, -1.0..1.0
+LIB8STATIC saccum1516 sin1516(uint16_t theta)
+{
+    uint16_t a = theta & 0x3fff;
+    if (theta & 0x4000)
+        a = 0x4000 - a;                  // 1..0x4000, mirrored quadrant
+    uint16_t idx = a >> 6;               // 0..256
+    uint8_t frac = (a & 0x3f) << 2;      // 0..252
+    uint32_t v = fixed_sin_table[idx];
+    if (frac)
+        v += ((fixed_sin_table[idx + 1] - v) * frac) >> 8;
+    v += v >> 15;                        // 65535 -> 65536
+    return theta & 0x8000 ? -(saccum1516)v : (saccum1516)v;
+}
+
+/// Cosine of 16-bit angle as Q16.16, -1.0..1.0
+LIB8STATIC saccum1516 cos1516(uint16_t theta)
+{
+    return sin1516(theta + 16384);
+}
+
+/// Integer square root, floor(sqrt(x))
+uint32_t sqrt64(uint64_t x);
+
+/// Square root of Q16.16 value, v must not be negative
+LIB8STATIC saccum1516 sqrt1516(saccum1516 v)
+{
+    return (saccum1516)sqrt64((uint64_t)v << 16);
+}
+
+/// Angle of vector (x, y) in 16-bit units, 0 for (1, 0), 16384 for (0, 1)
+uint16_t atan2_16(int32_t y, int32_t x);
+
+/// Sum of two vectors
+LIB8STATIC_ALWAYS_INLINE vec2_1516_t vec2_add(vec2_1516_t a, vec2_1516_t b)
+{
+    vec2_1516_t r = { a.x + b.x, a.y + b.y };
+    return r;
+}
+
+/// Difference of two vectors
+LIB8STATIC_ALWAYS_INLINE vec2_1516_t vec2_sub(vec2_1516_t a, vec2_1516_t b)
+{
+    vec2_1516_t r = { a.x - b.x, a.y - b.y };
+    return r;
+}
+
+/// Vector multiplied by Q16.16 scalar
+LIB8STATIC_ALWAYS_INLINE vec2_1516_t vec2_scale(vec2_1516_t a, saccum1516 s)
+{
+    vec2_1516_t r = { mul1516(a.x, s), mul1516(a.y, s) };
+    return r;
+}
+
+/// Dot product of two vectors
+LIB8STATIC_ALWAYS_INLINE saccum1516 vec2_dot(vec2_1516_t a, vec2_1516_t b)
+{
+    return (saccum1516)(((int64_t)a.x * b.x + (int64_t)a.y * b.y) >> 16);
+}
+
+/// Length of vector
+LIB8STATIC saccum1516 vec2_length(vec2_1516_t a)
+{
+    return (saccum1516)sqrt64((uint64_t)((int64_t)a.x * a.x) + (uint64_t)((int64_t)a.y * a.y));
+}
+
+/// Vector rotated by 16-bit angle counterclockwise
+LIB8STATIC vec2_1516_t vec2_rotate(vec2_1516_t a, uint16_t theta)
+{
+    saccum1516 s = sin1516(theta);
+    saccum1516 c = cos1516(theta);
+    vec2_1516_t r = {
+        (saccum1516)(((int64_t)a.x * c - (int64_t)a.y * s) >> 16),
+        (saccum1516)(((int64_t)a.x * s + (int64_t)a.y * c) >> 16),
+    };
+    return r;
+}
+
+/// Linear interpolation between two vectors
+LIB8STATIC vec2_1516_t vec2_lerp(vec2_1516_t a, vec2_1516_t b, fract16 frac)
+{
+    vec2_1516_t r = { lerp1516(a.x, b.x, frac), lerp1516(a.y, b.y, frac) };
+    return r;
+}
+
+///@}
+
+#endif /* __INC_LIB8TION_FIXED_H */
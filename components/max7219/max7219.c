@@ -40,6 +40,7 @@
 #include "max7219.h"
 #include <string.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 
 #include "max7219_priv.h"
 
@@ -48,6 +49,7 @@ static const char *TAG = "max7219";
 #define ALL_CHIPS 0xff
 #define ALL_DIGITS 8
 
+#define REG_NO_OP        (0 << 8)
 #define REG_DIGIT_0      (1 << 8)
 #define REG_DECODE_MODE  (9 << 8)
 #define REG_INTENSITY    (10 << 8)
@@ -80,7 +82,15 @@ static esp_err_t send(max7219_t *dev, uint8_t chip, uint16_t value)
     memset(&t, 0, sizeof(t));
     t.length = dev->cascade_size * 16;
     t.tx_buffer = buf;
-    return spi_device_transmit(dev->spi_dev, &t);
+    // transactions are tiny, polling is cheaper than interrupt
+    return spi_device_polling_transmit(dev->spi_dev, &t);
+}
+
+static inline uint8_t *frame_digit(max7219_t *dev, uint8_t *regs, uint8_t digit)
+{
+    if (dev->mirrored)
+        digit = dev->digits - digit - 1;
+    return regs + digit;
 }
 
 inline static uint8_t get_char(max7219_t *dev, char c)
@@ -217,6 +227,7 @@ esp_err_t max7219_set_digit(max7219_t *dev, uint8_t digit, uint8_t val)
     ESP_LOGV(TAG, "Chip %d, digit %d val 0x%02x", c, d, val);
 
     CHECK(send(dev, c, (REG_DIGIT_0 + ((uint16_t)d << 8)) | val));
+    dev->frame[digit] = dev->shown[digit] = val;
 
     return ESP_OK;
 }
@@ -228,6 +239,8 @@ esp_err_t max7219_clear(max7219_t *dev)
     uint8_t val = dev->bcd ? VAL_CLEAR_BCD : VAL_CLEAR_NORMAL;
     for (uint8_t i = 0; i < ALL_DIGITS; i++)
         CHECK(send(dev, ALL_CHIPS, (REG_DIGIT_0 + ((uint16_t)i << 8)) | val));
+    memset(dev->frame, val, sizeof(dev->frame));
+    memset(dev->shown, val, sizeof(dev->shown));
 
     return ESP_OK;
 }
@@ -261,3 +274,61 @@ esp_err_t max7219_draw_image_8x8(max7219_t *dev, uint8_t pos, const void *image)
 
     return ESP_OK;
 }
+
+esp_err_t max7219_frame_set_digit(max7219_t *dev, uint8_t digit, uint8_t val)
+{
+    CHECK_ARG(dev && digit < dev->digits);
+
+    *frame_digit(dev, dev->frame, digit) = val;
+
+    return ESP_OK;
+}
+
+esp_err_t max7219_frame_draw_image_8x8(max7219_t *dev, uint8_t pos, const void *image)
+{
+    CHECK_ARG(dev && image);
+
+    for (uint8_t i = pos, offs = 0; i < dev->digits && offs < 8; i++, offs++)
+        *frame_digit(dev, dev->frame, i) = *((uint8_t *)image + offs);
+
+    return ESP_OK;
+}
+
+esp_err_t max7219_flush(max7219_t *dev)
+{
+    CHECK_ARG(dev && dev->cascade_size);
+
+    int64_t start = esp_timer_get_time();
+
+    for (uint8_t d = 0; d < ALL_DIGITS; d++)
+    {
+        uint16_t buf[MAX7219_MAX_CASCADE_SIZE];
+        bool changed = false;
+        for (uint8_t c = 0; c < dev->cascade_size; c++)
+        {
+            uint8_t i = c * ALL_DIGITS + d;
+            if (dev->frame[i] == dev->shown[i])
+            {
+                buf[c] = shuffle(REG_NO_OP);
+                continue;
+            }
+            buf[c] = shuffle((REG_DIGIT_0 + ((uint16_t)d << 8)) | dev->frame[i]);
+            changed = true;
+        }
+        if (!changed)
+            continue;
+
+        spi_transaction_t t;
+        memset(&t, 0, sizeof(t));
+        t.length = dev->cascade_size * 16;
+        t.tx_buffer = buf;
+        CHECK(spi_device_polling_transmit(dev->spi_dev, &t));
+
+        for (uint8_t c = 0; c < dev->cascade_size; c++)
+            dev->shown[c * ALL_DIGITS + d] = dev->frame[c * ALL_DIGITS + d];
+    }
+
+    dev->flush_us = esp_timer_get_time() - start;
+
+    return ESP_OK;
+}
@@ -68,6 +68,10 @@ typedef struct
     uint8_t cascade_size;        //!< Up to `MAX7219_MAX_CASCADE_SIZE` MAX721xx cascaded
     bool mirrored;               //!< true for horizontally mirrored displays
     bool bcd;
+    uint8_t frame[MAX7219_MAX_CASCADE_SIZE * 8]; //!< Digit registers to be sent by ::max7219_flush(),
+                                 //!< 8 registers of chip 0, then chip 1 and so on
+    uint8_t shown[MAX7219_MAX_CASCADE_SIZE * 8]; //!< Digit registers currently displayed
+    uint32_t flush_us;           //!< Duration of the last ::max7219_flush(), us
 } max7219_t;
 
 /**
@@ -165,6 +169,44 @@ esp_err_t max7219_draw_text_7seg(max7219_t *dev, uint8_t pos, const char *s);
  */
 esp_err_t max7219_draw_image_8x8(max7219_t *dev, uint8_t pos, const void *image);
 
+/**
+ * @brief Write data to digit of frame buffer
+ *
+ * This function does not actually change the display.
+ * Call ::max7219_flush() to send frame to the display.
+ *
+ * @param dev Display descriptor
+ * @param digit Digit index, 0..dev->digits - 1
+ * @param val Data
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_frame_set_digit(max7219_t *dev, uint8_t digit, uint8_t val);
+
+/**
+ * @brief Draw 64-bit image on 8x8 matrix in frame buffer
+ *
+ * This function does not actually change the display.
+ * Call ::max7219_flush() to send frame to the display.
+ *
+ * @param dev Display descriptor
+ * @param pos Start digit
+ * @param image 64-bit buffer with image data
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_frame_draw_image_8x8(max7219_t *dev, uint8_t pos, const void *image);
+
+/**
+ * @brief Send changed digits of frame buffer to the display
+ *
+ * Digits with the same index on all chips of cascade are sent in one
+ * SPI transaction, rows without changes are skipped, so the whole
+ * cascade is refreshed in at most 8 transactions.
+ *
+ * @param dev Display descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_flush(max7219_t *dev);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file max7219_fb.c
+ *
+ * Framebuffer renderer for cascades of MAX7219 8x8 LED matrices
+ *
+ * Copyright (c) 2017 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "max7219_fb.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+esp_err_t max7219_fb_render(framebuffer_t *fb, void *arg)
+{
+    max7219_t *dev = (max7219_t *)arg;
+    CHECK_ARG(fb && fb->data && dev && dev->digits == dev->cascade_size * 8u
+              && fb->width == dev->digits && fb->height == 8);
+
+    for (size_t c = 0; c < dev->cascade_size; c++)
+        for (size_t y = 0; y < 8; y++)
+        {
+            const rgb_t *row = fb->data + FB_OFFSET(fb, c * 8, y);
+            uint8_t bits = 0;
+            for (size_t x = 0; x < 8; x++)
+                if (rgb_luma(row[x]) >= MAX7219_FB_THRESHOLD)
+                    bits |= 0x80 >> x;
+            // same digit mapping as max7219_draw_image_8x8() for mirrored displays
+            max7219_frame_set_digit(dev, c * 8 + y, bits);
+        }
+
+    return max7219_flush(dev);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2019 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file max7219_fb.h
+ * @defgroup max7219_fb max7219_fb
+ * @{
+ *
+ * Framebuffer renderer for cascades of MAX7219 8x8 LED matrices
+ *
+ * Copyright (c) 2017 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __MAX7219_FB_H__
+#define __MAX7219_FB_H__
+
+#include <framebuffer.h>
+#include "max7219.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Minimal luma of framebuffer pixel to light the LED
+ */
+#define MAX7219_FB_THRESHOLD 128
+
+/**
+ * @brief Framebuffer render callback for MAX7219 matrices
+ *
+ * Framebuffer must be `cascade_size * 8` pixels wide and 8 pixels high,
+ * device must have all `cascade_size * 8` digits accessible. Chip 0 shows
+ * the leftmost 8 columns, bit 7 of digit register is the leftmost column
+ * of a chip and digit 0 is the top row. Mirrored displays use the same
+ * reversed digit order as ::max7219_draw_image_8x8(). Pixels are lit if
+ * their luma is not less than ::MAX7219_FB_THRESHOLD. Only changed rows
+ * are sent, see ::max7219_flush().
+ *
+ * Pass pointer to initialized ::max7219_t as render context.
+ *
+ * @param fb Framebuffer descriptor
+ * @param arg Display descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_fb_render(framebuffer_t *fb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MAX7219_FB_H__ */
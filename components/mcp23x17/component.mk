@@ -1,2 +1,2 @@
 COMPONENT_ADD_INCLUDEDIRS = .
-COMPONENT_DEPENDS = driver i2cdev log esp_idf_lib_helpers
+COMPONENT_DEPENDS = driver i2cdev log esp_idf_lib_helpers ioexp
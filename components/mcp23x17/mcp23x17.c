@@ -91,6 +91,24 @@ static esp_err_t read_reg_16(mcp23x17_t *dev, uint8_t reg, uint16_t *val)
     return ESP_OK;
 }
 
+static esp_err_t read_intr_regs(mcp23x17_t *dev, uint16_t *flags, uint16_t *cap, uint16_t *port)
+{
+    CHECK_ARG(dev && flags && cap && port);
+
+    uint8_t buf[6];
+
+    // INTFA, INTFB, INTCAPA, INTCAPB, GPIOA, GPIOB in one transaction
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, i2c_dev_read_reg(dev, REG_INTFA, buf, 6));
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    *flags = (buf[1] << 8) | buf[0];
+    *cap = (buf[3] << 8) | buf[2];
+    *port = (buf[5] << 8) | buf[4];
+
+    return ESP_OK;
+}
+
 static esp_err_t write_reg_16(mcp23x17_t *dev, uint8_t reg, uint16_t val)
 {
     CHECK_ARG(dev);
@@ -180,6 +198,28 @@ static esp_err_t read_reg_16(mcp23x17_t *dev, uint8_t reg, uint16_t *val)
     return ESP_OK;
 }
 
+static esp_err_t read_intr_regs(mcp23x17_t *dev, uint16_t *flags, uint16_t *cap, uint16_t *port)
+{
+    CHECK_ARG(dev && flags && cap && port);
+
+    uint8_t rx[8] = { 0 };
+    uint8_t tx[8] = { (dev->addr << 1) | 0x01, REG_INTFA, 0, 0, 0, 0, 0, 0 };
+
+    spi_transaction_t t;
+    memset(&t, 0, sizeof(spi_transaction_t));
+    t.rx_buffer = rx;
+    t.tx_buffer = tx;
+    t.length = 64;   // 64 bits: INTFA, INTFB, INTCAPA, INTCAPB, GPIOA, GPIOB
+
+    CHECK(spi_transmit(dev, &t));
+
+    *flags = (rx[3] << 8) | rx[2];
+    *cap = (rx[5] << 8) | rx[4];
+    *port = (rx[7] << 8) | rx[6];
+
+    return ESP_OK;
+}
+
 static esp_err_t write_reg_16(mcp23x17_t *dev, uint8_t reg, uint16_t val)
 {
     CHECK_ARG(dev);
@@ -506,3 +546,44 @@ esp_err_t mcp23x17_set_interrupt(mcp23x17_t *dev, uint8_t pin, mcp23x17_gpio_int
 {
     return mcp23x17_port_set_interrupt(dev, BV(pin), intr);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+static esp_err_t ioexp_read_input(void *dev, uint16_t *val)
+{
+    return read_reg_16(dev, REG_GPIOA, val);
+}
+
+static esp_err_t ioexp_write_output(void *dev, uint16_t val)
+{
+    return write_reg_16(dev, REG_OLATA, val);
+}
+
+static esp_err_t ioexp_write_mode(void *dev, uint16_t val)
+{
+    return write_reg_16(dev, REG_IODIRA, val);
+}
+
+static esp_err_t ioexp_write_pullup(void *dev, uint16_t val)
+{
+    return write_reg_16(dev, REG_GPPUA, val);
+}
+
+static esp_err_t ioexp_read_intr(void *dev, uint16_t *flags, uint16_t *val)
+{
+    uint16_t cap, port;
+    CHECK(read_intr_regs(dev, flags, &cap, &port));
+    // captured levels are valid only for flagged pins
+    *val = (cap & *flags) | (port & ~*flags);
+
+    return ESP_OK;
+}
+
+const ioexp_ops_t mcp23x17_ioexp_ops = {
+    .pins = 16,
+    .read_input = ioexp_read_input,
+    .write_output = ioexp_write_output,
+    .write_mode = ioexp_write_mode,
+    .write_pullup = ioexp_write_pullup,
+    .read_intr = ioexp_read_intr,
+};
@@ -45,6 +45,7 @@
 #include <driver/spi_master.h>
 #include <driver/gpio.h>
 #include <esp_err.h>
+#include <ioexp.h>
 
 #define MCP23X17_ADDR_BASE 0x20
 
@@ -332,6 +333,11 @@ esp_err_t mcp23x17_port_set_interrupt(mcp23x17_t *dev, uint16_t mask, mcp23x17_g
  */
 esp_err_t mcp23x17_set_interrupt(mcp23x17_t *dev, uint8_t pin, mcp23x17_gpio_intr_t intr);
 
+/**
+ * Operations for generic expander layer, use pointer to ::mcp23x17_t as device
+ */
+extern const ioexp_ops_t mcp23x17_ioexp_ops;
+
 
 #ifdef __cplusplus
 }
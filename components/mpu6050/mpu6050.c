@@ -48,6 +48,7 @@
 #include "mpu6050_regs.h"
 #include <math.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
@@ -943,8 +944,66 @@ esp_err_t mpu6050_get_rotation_axis(mpu6050_dev_t *dev, mpu6050_axis_t axis, flo
 
 esp_err_t mpu6050_get_motion(mpu6050_dev_t *dev, mpu6050_acceleration_t *accel, mpu6050_rotation_t *gyro)
 {
-    CHECK(mpu6050_get_acceleration(dev, accel));
-    CHECK(mpu6050_get_rotation(dev, gyro));
+    CHECK_ARG(accel && gyro);
+
+    mpu6050_motion_t sample;
+    CHECK(mpu6050_get_motion_sample(dev, &sample));
+
+    *accel = sample.accel;
+    *gyro = sample.gyro;
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_get_raw_motion(mpu6050_dev_t *dev, mpu6050_raw_motion_t *raw)
+{
+    CHECK_ARG(dev && raw);
+
+    uint16_t buf[7];
+
+    I2C_DEV_TAKE_MUTEX(&dev->i2c_dev);
+    I2C_DEV_CHECK(&dev->i2c_dev, i2c_dev_read_reg(&dev->i2c_dev, MPU6050_REGISTER_ACCEL_XOUT_H, buf, sizeof(buf)));
+    I2C_DEV_GIVE_MUTEX(&dev->i2c_dev);
+
+    raw->accel.x = shuffle(buf[0]);
+    raw->accel.y = shuffle(buf[1]);
+    raw->accel.z = shuffle(buf[2]);
+    raw->temp = shuffle(buf[3]);
+    raw->gyro.x = shuffle(buf[4]);
+    raw->gyro.y = shuffle(buf[5]);
+    raw->gyro.z = shuffle(buf[6]);
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_get_motion_sample(mpu6050_dev_t *dev, mpu6050_motion_t *sample)
+{
+    CHECK_ARG(dev && sample);
+
+    mpu6050_raw_motion_t raw;
+    int64_t timestamp = esp_timer_get_time();
+    CHECK(mpu6050_get_raw_motion(dev, &raw));
+    CHECK(mpu6050_convert_raw_motion(dev, &raw, sample));
+    sample->timestamp = timestamp;
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_convert_raw_motion(mpu6050_dev_t *dev, const mpu6050_raw_motion_t *raw, mpu6050_motion_t *sample)
+{
+    CHECK_ARG(dev && raw && sample);
+
+    float ares = accel_res[dev->ranges.accel];
+    float gres = gyro_res[dev->ranges.gyro];
+
+    sample->accel.x = raw->accel.x * ares;
+    sample->accel.y = raw->accel.y * ares;
+    sample->accel.z = raw->accel.z * ares;
+    sample->gyro.x = raw->gyro.x * gres;
+    sample->gyro.y = raw->gyro.y * gres;
+    sample->gyro.z = raw->gyro.z * gres;
+    sample->temp = ((float)raw->temp / 340.0f) + 36.53f;
+
     return ESP_OK;
 }
 
@@ -1201,7 +1260,7 @@ esp_err_t mpu6050_get_fifo_bytes(mpu6050_dev_t *dev, uint8_t *data, size_t lengt
     CHECK_ARG(dev && data && length);
 
     I2C_DEV_TAKE_MUTEX(&dev->i2c_dev);
-    I2C_DEV_CHECK(&dev->i2c_dev, i2c_dev_read_reg(&dev->i2c_dev, MPU6050_REGISTER_FIFO_COUNTH, data, length));
+    I2C_DEV_CHECK(&dev->i2c_dev, i2c_dev_read_reg(&dev->i2c_dev, MPU6050_REGISTER_FIFO_R_W, data, length));
     I2C_DEV_GIVE_MUTEX(&dev->i2c_dev);
 
     return ESP_OK;
@@ -97,6 +97,28 @@ typedef struct
     float z; //!< rotation axis z
 } mpu6050_rotation_t;
 
+/**
+ * Raw motion data, read in one burst
+ */
+typedef struct
+{
+    mpu6050_raw_acceleration_t accel; //!< raw acceleration
+    int16_t temp;                     //!< raw temperature
+    mpu6050_raw_rotation_t gyro;      //!< raw rotation
+} mpu6050_raw_motion_t;
+
+/**
+ * MPU6050 motion sample: acceleration, rotation and temperature
+ * from the same sampling instant
+ */
+typedef struct
+{
+    int64_t timestamp;            //!< time of the readout start since boot, us
+    mpu6050_acceleration_t accel; //!< acceleration, g
+    mpu6050_rotation_t gyro;      //!< rotation, °/s
+    float temp;                   //!< internal temperature, °C
+} mpu6050_motion_t;
+
 /**
  * Auxiliary I2C supply voltage levels
  */
@@ -1686,7 +1708,7 @@ esp_err_t mpu6050_get_raw_rotation_axis(mpu6050_dev_t *dev, mpu6050_axis_t axis,
 /**
  * @brief Get raw 6-axis motion sensor readings (accel/gyro).
  *
- * Retrieves all currently available motion sensor values.
+ * Retrieves all currently available motion sensor values in one burst read.
  *
  * @param dev Device descriptor
  * @param[out] data_accel acceleration struct.
@@ -1696,6 +1718,46 @@ esp_err_t mpu6050_get_raw_rotation_axis(mpu6050_dev_t *dev, mpu6050_axis_t axis,
  */
 esp_err_t mpu6050_get_motion(mpu6050_dev_t *dev, mpu6050_acceleration_t *data_accel, mpu6050_rotation_t *data_gyro);
 
+/**
+ * @brief Get raw accelerometer, temperature and gyroscope readings.
+ *
+ * All 14 bytes from ACCEL_XOUT_H to GYRO_ZOUT_L are read in one burst,
+ * so the values belong to the same sampling instant.
+ *
+ * @param dev Device descriptor
+ * @param[out] raw Raw motion data
+ *
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_get_raw_motion(mpu6050_dev_t *dev, mpu6050_raw_motion_t *raw);
+
+/**
+ * @brief Get timestamped motion sample.
+ *
+ * Same as ::mpu6050_get_raw_motion() with values converted to g, °/s
+ * and °C using the current full scale ranges.
+ *
+ * @param dev Device descriptor
+ * @param[out] sample Motion sample
+ *
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_get_motion_sample(mpu6050_dev_t *dev, mpu6050_motion_t *sample);
+
+/**
+ * @brief Convert raw motion data to g, °/s and °C.
+ *
+ * Current full scale ranges of the device are used. Timestamp of the
+ * sample is not changed.
+ *
+ * @param dev Device descriptor
+ * @param raw Raw motion data
+ * @param[out] sample Motion sample
+ *
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_convert_raw_motion(mpu6050_dev_t *dev, const mpu6050_raw_motion_t *raw, mpu6050_motion_t *sample);
+
 /**
  * @brief Read bytes from external sensor data register.
  *
@@ -0,0 +1,355 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/**
+ * @file mpu6050_stream.c
+ *
+ * FIFO streaming for MPU6050.
+ *
+ * Copyright (c) 2023 Ruslan V. Uss <unclerus@gmail.com>
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
+#include "mpu6050_stream.h"
+
+static const char *TAG = "mpu6050_stream";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define TASK_STACK_SIZE 2048
+
+static inline int16_t get_word(const uint8_t *p)
+{
+    return (int16_t)((p[0] << 8) | p[1]);
+}
+
+static inline size_t ring_count(mpu6050_stream_t *stream)
+{
+    return __atomic_load_n(&stream->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&stream->tail, __ATOMIC_ACQUIRE);
+}
+
+static mpu6050_motion_t *ring_slot(mpu6050_stream_t *stream)
+{
+    if (stream->head - __atomic_load_n(&stream->tail, __ATOMIC_ACQUIRE) >= stream->size)
+    {
+        stream->overruns++;
+        return NULL;
+    }
+    return stream->buf + (stream->head & (stream->size - 1));
+}
+
+static void IRAM_ATTR int_isr(void *arg)
+{
+    mpu6050_stream_t *stream = (mpu6050_stream_t *)arg;
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&stream->lock);
+    stream->irq_time = now;
+    stream->irq_count++;
+    bool wake = ++stream->pending >= stream->batch;
+    if (wake)
+        stream->pending = 0;
+    portEXIT_CRITICAL_ISR(&stream->lock);
+
+    if (!wake)
+        return;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(stream->task, &woken);
+    if (woken == pdTRUE)
+        portYIELD_FROM_ISR();
+}
+
+static void parse_frame(mpu6050_stream_t *stream, const uint8_t *p, int64_t timestamp)
+{
+    mpu6050_motion_t *s = ring_slot(stream);
+    if (!s)
+        return;
+
+    mpu6050_raw_motion_t raw = { 0 };
+    // FIFO frame layout follows register order: accel, temp, gyro
+    if (stream->sensors & MPU6050_STREAM_ACCEL)
+    {
+        raw.accel.x = get_word(p);
+        raw.accel.y = get_word(p + 2);
+        raw.accel.z = get_word(p + 4);
+        p += 6;
+    }
+    if (stream->sensors & MPU6050_STREAM_TEMP)
+    {
+        raw.temp = get_word(p);
+        p += 2;
+    }
+    if (stream->sensors & MPU6050_STREAM_GYRO)
+    {
+        raw.gyro.x = get_word(p);
+        raw.gyro.y = get_word(p + 2);
+        raw.gyro.z = get_word(p + 4);
+    }
+
+    mpu6050_convert_raw_motion(stream->dev, &raw, s);
+    s->timestamp = timestamp;
+    // zero raw temperature is not zero degrees
+    if (!(stream->sensors & MPU6050_STREAM_TEMP))
+        s->temp = 0;
+
+    __atomic_store_n(&stream->head, stream->head + 1, __ATOMIC_RELEASE);
+}
+
+static esp_err_t reset_fifo(mpu6050_stream_t *stream)
+{
+    CHECK(mpu6050_reset_fifo(stream->dev));
+
+    portENTER_CRITICAL(&stream->lock);
+    stream->irq_base = stream->irq_count;
+    stream->pending = 0;
+    portEXIT_CRITICAL(&stream->lock);
+    stream->parsed = 0;
+
+    return ESP_OK;
+}
+
+static esp_err_t drain(mpu6050_stream_t *stream)
+{
+    uint16_t count;
+    CHECK(mpu6050_get_fifo_count(stream->dev, &count));
+
+    if (count >= MPU6050_FIFO_SIZE)
+    {
+        // oldest data is overwritten, frame boundaries are lost
+        stream->overflows++;
+        ESP_LOGW(TAG, "FIFO overflow");
+        return reset_fifo(stream);
+    }
+
+    size_t frames = count / stream->frame_size;
+    if (!frames)
+        return ESP_OK;
+
+    // interrupt N is raised when sample N is written to FIFO, so sample
+    // with index I since FIFO reset was taken at
+    // irq_time - (irq_count - irq_base - 1 - I) * period
+    portENTER_CRITICAL(&stream->lock);
+    int64_t irq_time = stream->irq_time;
+    uint32_t irqs = stream->irq_count - stream->irq_base;
+    portEXIT_CRITICAL(&stream->lock);
+
+    CHECK(mpu6050_get_fifo_bytes(stream->dev, stream->raw, frames * stream->frame_size));
+
+    for (size_t i = 0; i < frames; i++, stream->parsed++)
+    {
+        int64_t timestamp = irq_time - ((int64_t)irqs - 1 - stream->parsed) * stream->period_us;
+        parse_frame(stream, stream->raw + i * stream->frame_size, timestamp);
+    }
+
+    return ESP_OK;
+}
+
+static void stream_task(void *arg)
+{
+    mpu6050_stream_t *stream = (mpu6050_stream_t *)arg;
+    // wake up anyway if interrupts are lost
+    TickType_t timeout = pdMS_TO_TICKS(stream->batch * stream->period_us * 2 / 1000) + 1;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, timeout);
+        if (stream->stop)
+            break;
+        esp_err_t res = drain(stream);
+        if (res != ESP_OK)
+            ESP_LOGE(TAG, "Error draining FIFO: %d (%s)", res, esp_err_to_name(res));
+    }
+
+    xSemaphoreGive(stream->stopped);
+    vTaskDelete(NULL);
+}
+
+static void stop_task(mpu6050_stream_t *stream)
+{
+    // let the worker finish its I2C transaction, killing it could leave
+    // the bus mutex taken
+    stream->stop = true;
+    xTaskNotifyGive(stream->task);
+    xSemaphoreTake(stream->stopped, portMAX_DELAY);
+    stream->task = NULL;
+}
+
+static esp_err_t setup_device(mpu6050_stream_t *stream, uint8_t rate_div)
+{
+    mpu6050_dev_t *dev = stream->dev;
+
+    CHECK(mpu6050_set_fifo_enabled(dev, false));
+    CHECK(mpu6050_set_int_enabled(dev, 0));
+
+    mpu6050_dlpf_mode_t dlpf;
+    CHECK(mpu6050_get_dlpf_mode(dev, &dlpf));
+    CHECK(mpu6050_set_rate(dev, rate_div));
+    // gyroscope output rate is 8 kHz with disabled DLPF
+    stream->period_us = (dlpf == MPU6050_DLPF_0 || dlpf == 7 ? 125 : 1000) * (1 + rate_div);
+
+    CHECK(mpu6050_set_accel_fifo_enabled(dev, stream->sensors & MPU6050_STREAM_ACCEL));
+    CHECK(mpu6050_set_temp_fifo_enabled(dev, stream->sensors & MPU6050_STREAM_TEMP));
+    for (mpu6050_axis_t axis = MPU6050_X_AXIS; axis <= MPU6050_Z_AXIS; axis++)
+        CHECK(mpu6050_set_gyro_fifo_enabled(dev, axis, stream->sensors & MPU6050_STREAM_GYRO));
+
+    CHECK(mpu6050_set_interrupt_mode(dev, MPU6050_INT_LEVEL_HIGH));
+    CHECK(mpu6050_set_interrupt_drive(dev, MPU6050_INT_PUSH_PULL));
+    CHECK(mpu6050_set_interrupt_latch(dev, MPU6050_INT_LATCH_PULSE));
+
+    CHECK(reset_fifo(stream));
+    CHECK(mpu6050_set_fifo_enabled(dev, true));
+    CHECK(mpu6050_set_int_enabled(dev, MPU6050_INT_DATA_READY));
+
+    return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t mpu6050_stream_init(mpu6050_stream_t *stream, mpu6050_dev_t *dev, gpio_num_t int_gpio,
+        uint8_t sensors, uint8_t rate_div, size_t batch, size_t buf_size, UBaseType_t priority)
+{
+    CHECK_ARG(stream && dev && sensors && !(sensors & ~(MPU6050_STREAM_ACCEL | MPU6050_STREAM_TEMP | MPU6050_STREAM_GYRO)));
+    CHECK_ARG(buf_size && !(buf_size & (buf_size - 1)));
+
+    size_t frame_size = (sensors & MPU6050_STREAM_ACCEL ? 6 : 0)
+                      + (sensors & MPU6050_STREAM_TEMP ? 2 : 0)
+                      + (sensors & MPU6050_STREAM_GYRO ? 6 : 0);
+    CHECK_ARG(batch && batch * frame_size * 2 <= MPU6050_FIFO_SIZE);
+
+    esp_err_t res = gpio_install_isr_service(0);
+    if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+        return res;
+
+    memset(stream, 0, sizeof(mpu6050_stream_t));
+    stream->dev = dev;
+    stream->int_gpio = int_gpio;
+    stream->sensors = sensors;
+    stream->frame_size = frame_size;
+    stream->batch = batch;
+    stream->size = buf_size;
+    portMUX_INITIALIZE(&stream->lock);
+
+    stream->buf = calloc(buf_size, sizeof(mpu6050_motion_t));
+    // drain buffer fits the whole FIFO
+    stream->raw = malloc(MPU6050_FIFO_SIZE);
+    stream->stopped = xSemaphoreCreateBinary();
+    if (!stream->buf || !stream->raw || !stream->stopped)
+    {
+        res = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+
+    if ((res = setup_device(stream, rate_div)) != ESP_OK)
+        goto fail;
+
+    if (xTaskCreate(stream_task, TAG, TASK_STACK_SIZE, stream, priority, &stream->task) != pdPASS)
+    {
+        res = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+
+    gpio_config_t conf = {
+        .pin_bit_mask = BIT64(int_gpio),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = 0,
+        .pull_down_en = 0,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    if ((res = gpio_config(&conf)) != ESP_OK)
+        goto fail;
+    if ((res = gpio_isr_handler_add(int_gpio, int_isr, stream)) != ESP_OK)
+        goto fail;
+
+    return ESP_OK;
+
+fail:
+    if (stream->task)
+        stop_task(stream);
+    if (stream->stopped)
+        vSemaphoreDelete(stream->stopped);
+    stream->stopped = NULL;
+    free(stream->buf);
+    free(stream->raw);
+    stream->buf = NULL;
+    stream->raw = NULL;
+    return res;
+}
+
+esp_err_t mpu6050_stream_done(mpu6050_stream_t *stream)
+{
+    CHECK_ARG(stream && stream->task);
+
+    gpio_isr_handler_remove(stream->int_gpio);
+    stop_task(stream);
+    vSemaphoreDelete(stream->stopped);
+    stream->stopped = NULL;
+
+    CHECK(mpu6050_set_int_enabled(stream->dev, 0));
+    CHECK(mpu6050_set_fifo_enabled(stream->dev, false));
+
+    free(stream->buf);
+    free(stream->raw);
+    stream->buf = NULL;
+    stream->raw = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_stream_available(mpu6050_stream_t *stream, size_t *count)
+{
+    CHECK_ARG(stream && stream->buf && count);
+
+    *count = ring_count(stream);
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_stream_read(mpu6050_stream_t *stream, mpu6050_motion_t *data, size_t len, size_t *read)
+{
+    CHECK_ARG(stream && stream->buf && data && read);
+
+    size_t tail = stream->tail;
+    size_t n = ring_count(stream);
+    if (n > len)
+        n = len;
+
+    for (size_t i = 0; i < n; i++)
+        data[i] = stream->buf[(tail + i) & (stream->size - 1)];
+    __atomic_store_n(&stream->tail, tail + n, __ATOMIC_RELEASE);
+
+    *read = n;
+
+    return ESP_OK;
+}
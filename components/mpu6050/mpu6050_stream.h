@@ -0,0 +1,168 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/**
+ * @file mpu6050_stream.h
+ * @defgroup mpu6050_stream mpu6050_stream
+ * @{
+ *
+ * FIFO streaming for MPU6050.
+ *
+ * Samples are collected by the FIFO of the device. Data ready interrupts
+ * are counted by the INT pin ISR, which wakes up the worker task after a
+ * batch of samples. The worker drains all complete FIFO frames in one burst
+ * and parses them into a ring buffer, restoring the time of each sample
+ * from the interrupt timestamps.
+ *
+ * Copyright (c) 2023 Ruslan V. Uss <unclerus@gmail.com>
+ */
+#ifndef __MPU6050_STREAM_H__
+#define __MPU6050_STREAM_H__
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <driver/gpio.h>
+#include "mpu6050.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Size of MPU6050 FIFO, bytes
+ */
+#define MPU6050_FIFO_SIZE 1024
+
+/**
+ * Sensors written to FIFO
+ */
+typedef enum {
+    MPU6050_STREAM_ACCEL = BIT(0), //!< Accelerometer, 6 bytes
+    MPU6050_STREAM_TEMP  = BIT(1), //!< Temperature sensor, 2 bytes
+    MPU6050_STREAM_GYRO  = BIT(2), //!< Gyroscope, 6 bytes
+} mpu6050_stream_sensors_t;
+
+/**
+ * Stream descriptor
+ */
+typedef struct
+{
+    mpu6050_dev_t *dev;          //!< Device descriptor
+    gpio_num_t int_gpio;         //!< GPIO connected to INT pin
+    uint8_t sensors;             //!< Sensors in FIFO, ::mpu6050_stream_sensors_t bits
+    size_t frame_size;           //!< Size of FIFO frame, bytes
+    size_t batch;                //!< Number of samples per FIFO drain
+    uint32_t period_us;          //!< Sample period, us
+
+    mpu6050_motion_t *buf;       //!< Ring buffer of samples
+    size_t size;                 //!< Ring buffer size, power of 2
+    volatile size_t head;        //!< Write position, updated by worker only
+    volatile size_t tail;        //!< Read position, updated by reader only
+    volatile uint32_t overruns;  //!< Number of samples dropped because of full ring buffer
+    volatile uint32_t overflows; //!< Number of FIFO overflows, samples are lost on each
+
+    portMUX_TYPE lock;           //!< Protects interrupt counters
+    uint32_t irq_count;          //!< Number of data ready interrupts
+    int64_t irq_time;            //!< Time of the last data ready interrupt, us
+    uint32_t parsed;             //!< Number of samples parsed since the last FIFO reset
+    uint32_t irq_base;           //!< Value of `irq_count` at the last FIFO reset
+    size_t pending;              //!< Interrupts since the last wakeup
+
+    uint8_t *raw;                //!< FIFO drain buffer
+    TaskHandle_t task;           //!< Worker task
+    volatile bool stop;          //!< Worker stop request
+    SemaphoreHandle_t stopped;   //!< Given by worker just before it exits
+} mpu6050_stream_t;
+
+/**
+ * @brief Start streaming
+ *
+ * Device must be initialized by ::mpu6050_init(). Function configures
+ * the FIFO, sample rate and INT pin (push-pull, active high, 50 us pulse,
+ * data ready interrupt only) and starts the worker task.
+ *
+ * Sample rate is gyroscope output rate (8 kHz if DLPF is disabled, 1 kHz
+ * otherwise) divided by `1 + rate_div`.
+ *
+ * @param stream Stream descriptor
+ * @param dev Device descriptor
+ * @param int_gpio GPIO connected to INT pin
+ * @param sensors Sensors to put into FIFO, ::mpu6050_stream_sensors_t bits
+ * @param rate_div Sample rate divider
+ * @param batch Number of samples per FIFO drain, FIFO must fit twice as many
+ * @param buf_size Ring buffer size in samples, must be a power of 2
+ * @param priority Worker task priority
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_stream_init(mpu6050_stream_t *stream, mpu6050_dev_t *dev, gpio_num_t int_gpio,
+        uint8_t sensors, uint8_t rate_div, size_t batch, size_t buf_size, UBaseType_t priority);
+
+/**
+ * @brief Stop streaming and free ring buffer
+ *
+ * Worker task finishes the FIFO drain in progress and exits, then FIFO
+ * and data ready interrupt of the device are disabled.
+ *
+ * @param stream Stream descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_stream_done(mpu6050_stream_t *stream);
+
+/**
+ * @brief Get number of samples waiting in the ring buffer
+ *
+ * @param stream Stream descriptor
+ * @param[out] count Number of samples
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_stream_available(mpu6050_stream_t *stream, size_t *count);
+
+/**
+ * @brief Read samples from the ring buffer
+ *
+ * Function does not block. Only one task may read a stream. Values of
+ * sensors not put into FIFO are zero.
+ *
+ * @param stream Stream descriptor
+ * @param[out] data Buffer for samples
+ * @param len Buffer size in samples
+ * @param[out] read Number of samples actually read
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_stream_read(mpu6050_stream_t *stream, mpu6050_motion_t *data, size_t len, size_t *read);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MPU6050_STREAM_H__ */
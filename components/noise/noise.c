@@ -489,3 +489,124 @@ void fill_raw_noise16into8(uint8_t *pData, uint8_t num_points, uint8_t octaves,
         scx <<= 1;
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Noise fields
+//
+// Rows are generated left to right: per-row and per-field values (lattice
+// row/layer, eased fractions) are computed once, gradient hashes of the
+// lattice cell corners are recomputed only when samples cross into the
+// next cell. Results are identical to per-point inoise8_2d()/inoise8_3d().
+
+static inline uint8_t noise8_out(int8_t n)
+{
+    n += 64;
+    return qadd8(n, n);
+}
+
+static void noise8_2d_row(uint8_t *out, size_t count, uint32_t x, uint32_t step, uint16_t y, uint8_t shift)
+{
+    uint8_t Y = y >> 8;
+    uint8_t v = ease8InOutQuad((uint8_t)y);
+    int8_t yy = ((uint8_t)y >> 1) & 0x7F;
+    int8_t yn = yy - 0x80;
+
+    uint8_t hAA = 0, hAB = 0, hBA = 0, hBB = 0;
+    int cell = -1;
+    for (size_t i = 0; i < count; i++, x += step)
+    {
+        uint16_t xs = x;
+        uint8_t X = xs >> 8;
+        if (X != cell)
+        {
+            uint8_t A = P(X) + Y;
+            uint8_t B = P(X + 1) + Y;
+            hAA = P(P(A));
+            hAB = P(P(A + 1));
+            hBA = P(P(B));
+            hBB = P(P(B + 1));
+            cell = X;
+        }
+        uint8_t u = ease8InOutQuad((uint8_t)xs);
+        int8_t xx = ((uint8_t)xs >> 1) & 0x7F;
+        int8_t xn = xx - 0x80;
+
+        int8_t X1 = lerp7by8(grad8_2d(hAA, xx, yy), grad8_2d(hBA, xn, yy), u);
+        int8_t X2 = lerp7by8(grad8_2d(hAB, xx, yn), grad8_2d(hBB, xn, yn), u);
+        out[i] = qadd8(out[i], noise8_out(lerp7by8(X1, X2, v)) >> shift);
+    }
+}
+
+static void noise8_3d_row(uint8_t *out, size_t count, uint32_t x, uint32_t step, uint16_t y, uint16_t z, uint8_t shift)
+{
+    uint8_t Y = y >> 8;
+    uint8_t Z = z >> 8;
+    uint8_t v = ease8InOutQuad((uint8_t)y);
+    uint8_t w = ease8InOutQuad((uint8_t)z);
+    int8_t yy = ((uint8_t)y >> 1) & 0x7F;
+    int8_t zz = ((uint8_t)z >> 1) & 0x7F;
+    int8_t yn = yy - 0x80;
+    int8_t zn = zz - 0x80;
+
+    uint8_t AA = 0, AB = 0, BA = 0, BB = 0;
+    uint8_t h[8] = { 0 };
+    int cell = -1;
+    for (size_t i = 0; i < count; i++, x += step)
+    {
+        uint16_t xs = x;
+        uint8_t X = xs >> 8;
+        if (X != cell)
+        {
+            uint8_t A = P(X) + Y;
+            uint8_t B = P(X + 1) + Y;
+            AA = P(A) + Z;
+            AB = P(A + 1) + Z;
+            BA = P(B) + Z;
+            BB = P(B + 1) + Z;
+            h[0] = P(AA);
+            h[1] = P(BA);
+            h[2] = P(AB);
+            h[3] = P(BB);
+            h[4] = P((uint8_t)(AA + 1));
+            h[5] = P((uint8_t)(BA + 1));
+            h[6] = P((uint8_t)(AB + 1));
+            h[7] = P((uint8_t)(BB + 1));
+            cell = X;
+        }
+        uint8_t u = ease8InOutQuad((uint8_t)xs);
+        int8_t xx = ((uint8_t)xs >> 1) & 0x7F;
+        int8_t xn = xx - 0x80;
+
+        int8_t X1 = lerp7by8(grad8_3d(h[0], xx, yy, zz), grad8_3d(h[1], xn, yy, zz), u);
+        int8_t X2 = lerp7by8(grad8_3d(h[2], xx, yn, zz), grad8_3d(h[3], xn, yn, zz), u);
+        int8_t X3 = lerp7by8(grad8_3d(h[4], xx, yy, zn), grad8_3d(h[5], xn, yy, zn), u);
+        int8_t X4 = lerp7by8(grad8_3d(h[6], xx, yn, zn), grad8_3d(h[7], xn, yn, zn), u);
+
+        int8_t Y1 = lerp7by8(X1, X2, v);
+        int8_t Y2 = lerp7by8(X3, X4, v);
+        out[i] = qadd8(out[i], noise8_out(lerp7by8(Y1, Y2, w)) >> shift);
+    }
+}
+
+void fill_noise8_2d(uint8_t *pData, size_t width, size_t height, uint8_t octaves,
+                    uint16_t x, uint16_t scalex, uint16_t y, uint16_t scaley)
+{
+    for (uint8_t o = 0; o < octaves; o++)
+    {
+        uint32_t yy = (uint32_t)y << o;
+        for (size_t row = 0; row < height; row++, yy += (uint32_t)scaley << o)
+            noise8_2d_row(pData + row * width, width, (uint32_t)x << o, (uint32_t)scalex << o, yy, o);
+    }
+}
+
+void fill_noise8_3d(uint8_t *pData, size_t width, size_t height, uint8_t octaves,
+                    uint16_t x, uint16_t scalex, uint16_t y, uint16_t scaley, uint16_t z)
+{
+    for (uint8_t o = 0; o < octaves; o++)
+    {
+        uint32_t yy = (uint32_t)y << o;
+        uint16_t zz = (uint32_t)z << o;
+        for (size_t row = 0; row < height; row++, yy += (uint32_t)scaley << o)
+            noise8_3d_row(pData + row * width, width, (uint32_t)x << o, (uint32_t)scalex << o, yy, zz, o);
+    }
+}
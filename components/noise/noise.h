@@ -91,6 +91,26 @@ int8_t inoise8_1d_raw(uint16_t x);
 void fill_raw_noise8(uint8_t *pData, uint8_t num_points, uint8_t octaves, uint16_t x, int scale, uint16_t time);
 void fill_raw_noise16into8(uint8_t *pData, uint8_t num_points, uint8_t octaves, uint32_t x, int scale, uint32_t time);
 ///@}
+
+///@{
+/// Noise field functions - fill a row-major `width * height` array of 8-bit values
+/// with 2d or 3d fractal noise. Every octave doubles the frequency and halves the
+/// amplitude, values are saturating-added to the array, so clear it first.
+/// Faster than calling inoise8_2d()/inoise8_3d() per point, results are the same.
+///@param pData the array of data to write into
+///@param width the number of columns
+///@param height the number of rows
+///@param octaves the number of octaves to use for noise
+///@param x the x position of the first column in the noise field
+///@param scalex the scale (distance) between columns
+///@param y the y position of the first row in the noise field
+///@param scaley the scale (distance) between rows
+///@param z the z position (time) in the noise field for 3d function
+void fill_noise8_2d(uint8_t *pData, size_t width, size_t height, uint8_t octaves,
+                    uint16_t x, uint16_t scalex, uint16_t y, uint16_t scaley);
+void fill_noise8_3d(uint8_t *pData, size_t width, size_t height, uint8_t octaves,
+                    uint16_t x, uint16_t scalex, uint16_t y, uint16_t scaley, uint16_t z);
+///@}
 ///@}
 
 #ifdef __cplusplus
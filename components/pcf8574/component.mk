@@ -1,2 +1,2 @@
 COMPONENT_ADD_INCLUDEDIRS = .
-COMPONENT_DEPENDS = i2cdev log esp_idf_lib_helpers
\ No newline at end of file
+COMPONENT_DEPENDS = i2cdev log esp_idf_lib_helpers ioexp
\ No newline at end of file
@@ -97,3 +97,38 @@ esp_err_t pcf8574_port_write(i2c_dev_t *dev, uint8_t val)
 {
     return write_port(dev, val);
 }
+
+esp_err_t pcf8574_port_write_buf(i2c_dev_t *dev, const uint8_t *data, size_t len)
+{
+    CHECK_ARG(dev && data && len);
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, i2c_dev_write(dev, NULL, 0, data, len));
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static esp_err_t ioexp_read_input(void *dev, uint16_t *val)
+{
+    CHECK_ARG(val);
+
+    uint8_t v;
+    CHECK(read_port(dev, &v));
+    *val = v;
+
+    return ESP_OK;
+}
+
+static esp_err_t ioexp_write_output(void *dev, uint16_t val)
+{
+    return write_port(dev, val);
+}
+
+const ioexp_ops_t pcf8574_ioexp_ops = {
+    .pins = 8,
+    .read_input = ioexp_read_input,
+    .write_output = ioexp_write_output,
+};
@@ -38,6 +38,7 @@
 #include <stddef.h>
 #include <i2cdev.h>
 #include <esp_err.h>
+#include <ioexp.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -83,6 +84,25 @@ esp_err_t pcf8574_port_read(i2c_dev_t *dev, uint8_t *val);
  */
 esp_err_t pcf8574_port_write(i2c_dev_t *dev, uint8_t value);
 
+/**
+ * @brief Write sequence of values to GPIO port in one transaction
+ *
+ * Each value is latched to the port at the end of its byte, so this
+ * is a cheap way to generate strobes (e.g. for HD44780 backpacks).
+ *
+ * @param dev Pointer to I2C device descriptor
+ * @param data GPIO port values
+ * @param len Number of values
+ * @return ESP_OK on success
+ */
+esp_err_t pcf8574_port_write_buf(i2c_dev_t *dev, const uint8_t *data, size_t len);
+
+/**
+ * Operations for generic expander layer, use pointer to I2C device
+ * descriptor as device
+ */
+extern const ioexp_ops_t pcf8574_ioexp_ops;
+
 #ifdef __cplusplus
 }
 #endif
@@ -96,3 +96,21 @@ esp_err_t pcf8575_port_write(i2c_dev_t *dev, uint16_t val)
 {
     return write_port(dev, val);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+static esp_err_t ioexp_read_input(void *dev, uint16_t *val)
+{
+    return read_port(dev, val);
+}
+
+static esp_err_t ioexp_write_output(void *dev, uint16_t val)
+{
+    return write_port(dev, val);
+}
+
+const ioexp_ops_t pcf8575_ioexp_ops = {
+    .pins = 16,
+    .read_input = ioexp_read_input,
+    .write_output = ioexp_write_output,
+};
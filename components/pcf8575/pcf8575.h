@@ -38,6 +38,7 @@
 #include <stddef.h>
 #include <i2cdev.h>
 #include <esp_err.h>
+#include <ioexp.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -82,6 +83,12 @@ esp_err_t pcf8575_port_read(i2c_dev_t *dev, uint16_t *val);
  */
 esp_err_t pcf8575_port_write(i2c_dev_t *dev, uint16_t value);
 
+/**
+ * Operations for generic expander layer, use pointer to I2C device
+ * descriptor as device
+ */
+extern const ioexp_ops_t pcf8575_ioexp_ops;
+
 #ifdef __cplusplus
 }
 #endif
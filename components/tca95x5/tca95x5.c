@@ -136,3 +136,26 @@ esp_err_t tca95x5_set_level(i2c_dev_t *dev, uint8_t pin, uint32_t val)
     return ESP_OK;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+static esp_err_t ioexp_read_input(void *dev, uint16_t *val)
+{
+    return read_reg_16(dev, REG_IN0, val);
+}
+
+static esp_err_t ioexp_write_output(void *dev, uint16_t val)
+{
+    return write_reg_16(dev, REG_OUT0, val);
+}
+
+static esp_err_t ioexp_write_mode(void *dev, uint16_t val)
+{
+    return write_reg_16(dev, REG_CONF0, val);
+}
+
+const ioexp_ops_t tca95x5_ioexp_ops = {
+    .pins = 16,
+    .read_input = ioexp_read_input,
+    .write_output = ioexp_write_output,
+    .write_mode = ioexp_write_mode,
+};
@@ -42,6 +42,7 @@
 #include <stddef.h>
 #include <i2cdev.h>
 #include <esp_err.h>
+#include <ioexp.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -132,6 +133,12 @@ esp_err_t tca95x5_get_level(i2c_dev_t *dev, uint8_t pin, uint32_t *val);
  */
 esp_err_t tca95x5_set_level(i2c_dev_t *dev, uint8_t pin, uint32_t val);
 
+/**
+ * Operations for generic expander layer, use pointer to I2C device
+ * descriptor as device
+ */
+extern const ioexp_ops_t tca95x5_ioexp_ops;
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,6 @@
 COMPONENT_ADD_INCLUDEDIRS = .
+# MCPWM capture driver is only available on ESP-IDF v5+
+COMPONENT_OBJEXCLUDE = ultrasonic_scheduler.o
 
 ifdef CONFIG_IDF_TARGET_ESP8266
 COMPONENT_DEPENDS = esp8266 freertos esp_idf_lib_helpers
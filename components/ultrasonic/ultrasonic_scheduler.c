@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2016 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ultrasonic_scheduler.c
+ *
+ * Interrupt-driven multi-sensor scheduler for ultrasonic range meters
+ *
+ * Copyright (c) 2016 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <ets_sys.h>
+#include "ultrasonic_scheduler.h"
+
+static const char *TAG = "ultrasonic_sched";
+
+#define TRIGGER_HIGH_DELAY 10
+#define PING_TIMEOUT 6000
+#define ROUNDTRIP_M 5800.0f
+#define ROUNDTRIP_CM 58
+#define TASK_STACK_SIZE 2048
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static bool IRAM_ATTR on_capture(mcpwm_cap_channel_handle_t channel, const mcpwm_capture_event_data_t *edata, void *arg)
+{
+    ultrasonic_channel_t *ch = (ultrasonic_channel_t *)arg;
+
+    if (edata->cap_edge == MCPWM_CAP_EDGE_POS)
+    {
+        ch->rise = edata->cap_value;
+        ch->armed = true;
+        return false;
+    }
+    if (!ch->armed)
+        return false;
+
+    ch->width = edata->cap_value - ch->rise;
+    ch->armed = false;
+
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(ch->sched->task, BIT(ch->index), eSetBits, &woken);
+    return woken == pdTRUE;
+}
+
+static uint32_t median(const uint32_t *values, size_t len)
+{
+    uint32_t buf[ULTRASONIC_MEDIAN_MAX];
+    memcpy(buf, values, len * sizeof(uint32_t));
+
+    // insertion sort, window is small
+    for (size_t i = 1; i < len; i++)
+    {
+        uint32_t v = buf[i];
+        size_t j = i;
+        for (; j > 0 && buf[j - 1] > v; j--)
+            buf[j] = buf[j - 1];
+        buf[j] = v;
+    }
+
+    return buf[len / 2];
+}
+
+static void store_result(ultrasonic_scheduler_t *sched, ultrasonic_channel_t *ch, esp_err_t status, uint32_t time_us)
+{
+    portENTER_CRITICAL(&sched->mux);
+    ch->status = status;
+    if (status == ESP_OK)
+    {
+        ch->history[ch->history_pos] = time_us;
+        ch->history_pos = (ch->history_pos + 1) % sched->config.median_size;
+        if (ch->history_len < sched->config.median_size)
+            ch->history_len++;
+        ch->measurements++;
+    }
+    else
+        ch->errors++;
+    portEXIT_CRITICAL(&sched->mux);
+}
+
+// returns true if any sensor of the slot was triggered
+static bool fire_slot(ultrasonic_scheduler_t *sched, uint8_t slot)
+{
+    uint32_t mask = 0;
+    for (size_t i = 0; i < sched->count; i++)
+    {
+        ultrasonic_channel_t *ch = sched->channels[i];
+        if (ch->slot != slot)
+            continue;
+        ch->armed = false;
+        mask |= BIT(i);
+    }
+    if (!mask)
+        return false;
+
+    // drop late notifications of the previous round
+    xTaskNotifyWait(0, UINT32_MAX, NULL, 0);
+
+    for (size_t i = 0; i < sched->count; i++)
+        if (mask & BIT(i))
+        {
+            // previous ping isn't ended
+            if (gpio_get_level(sched->channels[i]->dev.echo_pin))
+            {
+                store_result(sched, sched->channels[i], ESP_ERR_ULTRASONIC_PING, 0);
+                mask &= ~BIT(i);
+                continue;
+            }
+            gpio_set_level(sched->channels[i]->dev.trigger_pin, 1);
+        }
+    if (!mask)
+        return false;
+    ets_delay_us(TRIGGER_HIGH_DELAY);
+    for (size_t i = 0; i < sched->count; i++)
+        if (mask & BIT(i))
+            gpio_set_level(sched->channels[i]->dev.trigger_pin, 0);
+
+    int64_t started = esp_timer_get_time();
+    int64_t deadline = started + PING_TIMEOUT + sched->config.max_time_us;
+    uint32_t pending = mask;
+    while (pending)
+    {
+        int64_t left = deadline - esp_timer_get_time();
+        if (left <= 0)
+            break;
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(left / 1000) + 1) == pdTRUE)
+            pending &= ~bits;
+    }
+
+    for (size_t i = 0; i < sched->count; i++)
+    {
+        if (!(mask & BIT(i)))
+            continue;
+        ultrasonic_channel_t *ch = sched->channels[i];
+        if (pending & BIT(i))
+        {
+            store_result(sched, ch, ch->armed ? ESP_ERR_ULTRASONIC_ECHO_TIMEOUT : ESP_ERR_ULTRASONIC_PING_TIMEOUT, 0);
+            continue;
+        }
+        uint32_t time_us = (uint64_t)ch->width * 1000000 / sched->resolution_hz;
+        if (time_us > sched->config.max_time_us)
+            store_result(sched, ch, ESP_ERR_ULTRASONIC_ECHO_TIMEOUT, 0);
+        else
+            store_result(sched, ch, ESP_OK, time_us);
+    }
+
+    return true;
+}
+
+static void scheduler_task(void *arg)
+{
+    ultrasonic_scheduler_t *sched = (ultrasonic_scheduler_t *)arg;
+
+    uint8_t slots = 0;
+    for (size_t i = 0; i < sched->count; i++)
+        if (sched->channels[i]->slot >= slots)
+            slots = sched->channels[i]->slot + 1;
+
+    while (true)
+    {
+        int64_t started = esp_timer_get_time();
+        for (uint8_t slot = 0; slot < slots; slot++)
+        {
+            xSemaphoreTake(sched->lock, portMAX_DELAY);
+            bool fired = fire_slot(sched, slot);
+            xSemaphoreGive(sched->lock);
+            if (sched->config.holdoff_ms)
+                vTaskDelay(pdMS_TO_TICKS(sched->config.holdoff_ms));
+            // nothing blocked while waiting for echo (e.g. echo pin stuck
+            // high), so yield to lower priority tasks
+            else if (!fired)
+                vTaskDelay(1);
+        }
+        sched->cycle_time_us = esp_timer_get_time() - started;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+esp_err_t ultrasonic_scheduler_init(ultrasonic_scheduler_t *sched, const ultrasonic_scheduler_config_t *config)
+{
+    CHECK_ARG(sched && config && config->max_time_us
+            && config->median_size && config->median_size <= ULTRASONIC_MEDIAN_MAX);
+
+    memset(sched, 0, sizeof(ultrasonic_scheduler_t));
+    sched->config = *config;
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    sched->mux = mux;
+
+    sched->lock = xSemaphoreCreateMutex();
+    if (!sched->lock)
+        return ESP_ERR_NO_MEM;
+
+    return ESP_OK;
+}
+
+esp_err_t ultrasonic_scheduler_done(ultrasonic_scheduler_t *sched)
+{
+    CHECK_ARG(sched && sched->lock);
+
+    CHECK(ultrasonic_scheduler_stop(sched));
+
+    for (size_t i = 0; i < sched->count; i++)
+    {
+        ultrasonic_channel_t *ch = sched->channels[i];
+        CHECK(mcpwm_capture_channel_disable(ch->channel));
+        CHECK(mcpwm_del_capture_channel(ch->channel));
+        ch->sched = NULL;
+        sched->channels[i] = NULL;
+    }
+    sched->count = 0;
+
+    for (size_t i = 0; i < SOC_MCPWM_GROUPS; i++)
+    {
+        if (!sched->timers[i])
+            continue;
+        CHECK(mcpwm_capture_timer_disable(sched->timers[i]));
+        CHECK(mcpwm_del_capture_timer(sched->timers[i]));
+        sched->timers[i] = NULL;
+    }
+
+    vSemaphoreDelete(sched->lock);
+    sched->lock = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t ultrasonic_scheduler_add(ultrasonic_scheduler_t *sched, ultrasonic_channel_t *ch,
+        const ultrasonic_sensor_t *dev, uint8_t slot)
+{
+    CHECK_ARG(sched && sched->lock && ch && dev && slot < ULTRASONIC_SCHEDULER_MAX_SLOTS);
+
+    if (sched->task)
+        return ESP_ERR_INVALID_STATE;
+    if (sched->count >= ULTRASONIC_SCHEDULER_MAX_SENSORS
+            || sched->count >= SOC_MCPWM_GROUPS * SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER)
+        return ESP_ERR_NO_MEM;
+
+    // capture channels of one group share capture timer
+    size_t group = sched->count / SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER;
+    if (!sched->timers[group])
+    {
+        mcpwm_capture_timer_config_t timer_config = {
+            .group_id = group,
+            .clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+        };
+        CHECK(mcpwm_new_capture_timer(&timer_config, &sched->timers[group]));
+        CHECK(mcpwm_capture_timer_get_resolution(sched->timers[group], &sched->resolution_hz));
+        CHECK(mcpwm_capture_timer_enable(sched->timers[group]));
+    }
+
+    memset(ch, 0, sizeof(ultrasonic_channel_t));
+    ch->dev = *dev;
+    ch->slot = slot;
+    ch->sched = sched;
+    ch->index = sched->count;
+    ch->status = ESP_ERR_NOT_FOUND;
+
+    CHECK(gpio_set_direction(dev->trigger_pin, GPIO_MODE_OUTPUT));
+    CHECK(gpio_set_level(dev->trigger_pin, 0));
+
+    mcpwm_capture_channel_config_t channel_config = {
+        .gpio_num = dev->echo_pin,
+        .prescale = 1,
+        .flags.pos_edge = true,
+        .flags.neg_edge = true,
+    };
+    CHECK(mcpwm_new_capture_channel(sched->timers[group], &channel_config, &ch->channel));
+
+    mcpwm_capture_event_callbacks_t callbacks = {
+        .on_cap = on_capture,
+    };
+    esp_err_t res = mcpwm_capture_channel_register_event_callbacks(ch->channel, &callbacks, ch);
+    if (res == ESP_OK)
+        res = mcpwm_capture_channel_enable(ch->channel);
+    if (res != ESP_OK)
+    {
+        mcpwm_del_capture_channel(ch->channel);
+        ch->channel = NULL;
+        ch->sched = NULL;
+        return res;
+    }
+
+    sched->channels[sched->count++] = ch;
+
+    ESP_LOGD(TAG, "Sensor %d added to slot %d, trigger=%d, echo=%d", ch->index, slot, dev->trigger_pin, dev->echo_pin);
+
+    return ESP_OK;
+}
+
+esp_err_t ultrasonic_scheduler_start(ultrasonic_scheduler_t *sched)
+{
+    CHECK_ARG(sched && sched->lock && sched->count);
+
+    if (sched->task)
+        return ESP_ERR_INVALID_STATE;
+
+    for (size_t i = 0; i < SOC_MCPWM_GROUPS; i++)
+        if (sched->timers[i])
+            CHECK(mcpwm_capture_timer_start(sched->timers[i]));
+
+    if (xTaskCreate(scheduler_task, TAG, TASK_STACK_SIZE, sched, sched->config.priority, &sched->task) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    return ESP_OK;
+}
+
+esp_err_t ultrasonic_scheduler_stop(ultrasonic_scheduler_t *sched)
+{
+    CHECK_ARG(sched && sched->lock);
+
+    if (!sched->task)
+        return ESP_OK;
+
+    xSemaphoreTake(sched->lock, portMAX_DELAY);
+    vTaskDelete(sched->task);
+    sched->task = NULL;
+    xSemaphoreGive(sched->lock);
+
+    for (size_t i = 0; i < SOC_MCPWM_GROUPS; i++)
+        if (sched->timers[i])
+            CHECK(mcpwm_capture_timer_stop(sched->timers[i]));
+
+    return ESP_OK;
+}
+
+esp_err_t ultrasonic_scheduler_get_raw(ultrasonic_channel_t *ch, uint32_t *time_us)
+{
+    CHECK_ARG(ch && ch->sched && time_us);
+
+    ultrasonic_scheduler_t *sched = ch->sched;
+    uint32_t history[ULTRASONIC_MEDIAN_MAX];
+
+    portENTER_CRITICAL(&sched->mux);
+    esp_err_t status = ch->status;
+    size_t len = ch->history_len;
+    memcpy(history, ch->history, len * sizeof(uint32_t));
+    portEXIT_CRITICAL(&sched->mux);
+
+    if (status != ESP_OK)
+        return status;
+    if (!len)
+        return ESP_ERR_NOT_FOUND;
+
+    *time_us = median(history, len);
+
+    return ESP_OK;
+}
+
+esp_err_t ultrasonic_scheduler_get(ultrasonic_channel_t *ch, float *distance)
+{
+    CHECK_ARG(distance);
+
+    uint32_t time_us;
+    CHECK(ultrasonic_scheduler_get_raw(ch, &time_us));
+    *distance = time_us / ROUNDTRIP_M;
+
+    return ESP_OK;
+}
+
+esp_err_t ultrasonic_scheduler_get_cm(ultrasonic_channel_t *ch, uint32_t *distance)
+{
+    CHECK_ARG(distance);
+
+    uint32_t time_us;
+    CHECK(ultrasonic_scheduler_get_raw(ch, &time_us));
+    *distance = time_us / ROUNDTRIP_CM;
+
+    return ESP_OK;
+}
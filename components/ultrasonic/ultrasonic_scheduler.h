@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2016 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ultrasonic_scheduler.h
+ * @defgroup ultrasonic_scheduler ultrasonic_scheduler
+ * @{
+ *
+ * Interrupt-driven multi-sensor scheduler for ultrasonic range meters
+ *
+ * Echo pulses are timed by MCPWM capture channels, so CPU is free while
+ * waiting for echo. Sensors are grouped into slots: all sensors of one slot
+ * are triggered at once, slots are fired round-robin by a dedicated task.
+ * Put sensors that can hear each other into different slots.
+ * Results are filtered by a moving median.
+ *
+ * Copyright (c) 2016 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __ULTRASONIC_SCHEDULER_H__
+#define __ULTRASONIC_SCHEDULER_H__
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <soc/soc_caps.h>
+#include <driver/mcpwm_cap.h>
+#include "ultrasonic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ULTRASONIC_SCHEDULER_MAX_SENSORS 6 //!< Maximum number of sensors per scheduler
+#define ULTRASONIC_SCHEDULER_MAX_SLOTS   ULTRASONIC_SCHEDULER_MAX_SENSORS //!< Maximum number of slots
+#define ULTRASONIC_MEDIAN_MAX            9 //!< Maximum size of median filter window
+
+typedef struct ultrasonic_scheduler ultrasonic_scheduler_t;
+
+/**
+ * Sensor descriptor
+ */
+typedef struct
+{
+    ultrasonic_sensor_t dev;             //!< Sensor pins
+    uint8_t slot;                        //!< Slot number, sensors in one slot are triggered together
+    ultrasonic_scheduler_t *sched;       //!< Scheduler the sensor is attached to
+    uint8_t index;                       //!< Index of the sensor in scheduler
+
+    mcpwm_cap_channel_handle_t channel;  //!< MCPWM capture channel
+    volatile uint32_t rise;              //!< Capture value of echo rising edge
+    volatile uint32_t width;             //!< Echo width, capture timer ticks
+    volatile bool armed;                 //!< Rising edge captured
+
+    uint32_t history[ULTRASONIC_MEDIAN_MAX]; //!< Last echo times, us
+    size_t history_len;                  //!< Number of valid values in history
+    size_t history_pos;                  //!< Next write position in history
+    esp_err_t status;                    //!< Result of the last measurement
+    uint32_t measurements;               //!< Number of successful measurements
+    uint32_t errors;                     //!< Number of failed measurements
+} ultrasonic_channel_t;
+
+/**
+ * Scheduler configuration
+ */
+typedef struct
+{
+    uint32_t max_time_us;     //!< Maximal echo time, us
+    uint32_t holdoff_ms;      //!< Pause after each slot to let residual echoes die out, ms
+    uint8_t median_size;      //!< Median filter window, 1..ULTRASONIC_MEDIAN_MAX
+    UBaseType_t priority;     //!< Scheduler task priority
+} ultrasonic_scheduler_config_t;
+
+/**
+ * Scheduler descriptor
+ */
+struct ultrasonic_scheduler
+{
+    ultrasonic_scheduler_config_t config;
+    mcpwm_cap_timer_handle_t timers[SOC_MCPWM_GROUPS];
+    uint32_t resolution_hz;
+    ultrasonic_channel_t *channels[ULTRASONIC_SCHEDULER_MAX_SENSORS];
+    size_t count;
+    SemaphoreHandle_t lock;
+    portMUX_TYPE mux;
+    TaskHandle_t task;
+    uint32_t cycle_time_us;   //!< Duration of the last full round over all slots, us
+};
+
+/**
+ * @brief Initialize scheduler
+ *
+ * @param sched Scheduler descriptor
+ * @param config Scheduler configuration
+ * @return `ESP_OK` on success
+ */
+esp_err_t ultrasonic_scheduler_init(ultrasonic_scheduler_t *sched, const ultrasonic_scheduler_config_t *config);
+
+/**
+ * @brief Stop scheduler, detach all sensors and free resources
+ *
+ * @param sched Scheduler descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t ultrasonic_scheduler_done(ultrasonic_scheduler_t *sched);
+
+/**
+ * @brief Attach sensor to scheduler
+ *
+ * Sensors can only be added while scheduler is stopped.
+ *
+ * @param sched Scheduler descriptor
+ * @param ch Sensor descriptor
+ * @param dev Sensor pins
+ * @param slot Slot number, [0:ULTRASONIC_SCHEDULER_MAX_SLOTS - 1]
+ * @return `ESP_OK` on success
+ */
+esp_err_t ultrasonic_scheduler_add(ultrasonic_scheduler_t *sched, ultrasonic_channel_t *ch,
+        const ultrasonic_sensor_t *dev, uint8_t slot);
+
+/**
+ * @brief Start measurements
+ *
+ * @param sched Scheduler descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t ultrasonic_scheduler_start(ultrasonic_scheduler_t *sched);
+
+/**
+ * @brief Stop measurements
+ *
+ * @param sched Scheduler descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t ultrasonic_scheduler_stop(ultrasonic_scheduler_t *sched);
+
+/**
+ * @brief Get median of the last echo times
+ *
+ * @param ch Sensor descriptor
+ * @param[out] time_us Time, us
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_FOUND` if there are no
+ *         measurements yet, otherwise status of the last measurement
+ */
+esp_err_t ultrasonic_scheduler_get_raw(ultrasonic_channel_t *ch, uint32_t *time_us);
+
+/**
+ * @brief Get median distance in meters
+ *
+ * @param ch Sensor descriptor
+ * @param[out] distance Distance in meters
+ * @return `ESP_OK` on success, see ::ultrasonic_scheduler_get_raw()
+ */
+esp_err_t ultrasonic_scheduler_get(ultrasonic_channel_t *ch, float *distance);
+
+/**
+ * @brief Get median distance in centimeters
+ *
+ * @param ch Sensor descriptor
+ * @param[out] distance Distance in centimeters
+ * @return `ESP_OK` on success, see ::ultrasonic_scheduler_get_raw()
+ */
+esp_err_t ultrasonic_scheduler_get_cm(ultrasonic_channel_t *ch, uint32_t *distance);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __ULTRASONIC_SCHEDULER_H__ */
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2021 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file wiegand_service.c
+ *
+ * Multi-reader Wiegand receiver with batched frame decoding
+ *
+ * Copyright (c) 2021 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <esp_log.h>
+#include <string.h>
+#include <stdlib.h>
+#include <esp_idf_lib_helpers.h>
+#include "wiegand_service.h"
+
+static const char *TAG = "wiegand_service";
+
+#define TIMER_INTERVAL_US 50000 // 50ms
+#define TASK_STACK_SIZE 3072
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+#define CHECK_GOTO(x) do { if ((res = (x)) != ESP_OK) goto fail; } while (0)
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define TIMER_DISPATCH ESP_TIMER_ISR
+#define TIMER_CB_ATTR IRAM_ATTR
+#else
+#define TIMER_DISPATCH ESP_TIMER_TASK
+#define TIMER_CB_ATTR
+#endif
+
+/**
+ * Frame is finalized either from esp_timer task or from esp_timer ISR,
+ * so there is always a single producer and a single consumer (worker).
+ */
+static bool TIMER_CB_ATTR ring_push(wiegand_service_t *svc, const wiegand_frame_t *frame)
+{
+    size_t head = svc->head;
+    if (head - __atomic_load_n(&svc->tail, __ATOMIC_ACQUIRE) >= svc->ring_size)
+        return false;
+    svc->ring[head & (svc->ring_size - 1)] = *frame;
+    __atomic_store_n(&svc->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void IRAM_ATTR isr_handler(void *arg)
+{
+    wiegand_service_reader_t *reader = (wiegand_service_reader_t *)arg;
+
+    int d0 = gpio_get_level(reader->gpio_d0);
+    int d1 = gpio_get_level(reader->gpio_d1);
+
+    // ignore equal
+    if (d0 == d1)
+        return;
+
+    esp_timer_stop(reader->timer);
+
+    portENTER_CRITICAL_ISR(&reader->lock);
+    if (reader->bits < WIEGAND_SERVICE_MAX_BITS)
+    {
+        reader->data = (reader->data << 1) | (d0 ? 1 : 0);
+        reader->bits++;
+        reader->last_bit = esp_timer_get_time();
+    }
+    else if (reader->bits == WIEGAND_SERVICE_MAX_BITS)
+    {
+        // mark frame as broken
+        reader->bits++;
+        reader->overflows++;
+    }
+    portEXIT_CRITICAL_ISR(&reader->lock);
+
+    esp_timer_start_once(reader->timer, TIMER_INTERVAL_US);
+}
+
+static void TIMER_CB_ATTR timer_handler(void *arg)
+{
+    wiegand_service_reader_t *reader = (wiegand_service_reader_t *)arg;
+    wiegand_service_t *svc = reader->service;
+
+    wiegand_frame_t frame = { .reader = reader->index };
+
+    portENTER_CRITICAL_SAFE(&reader->lock);
+    frame.data = reader->data;
+    frame.bits = reader->bits;
+    frame.timestamp = reader->last_bit;
+    reader->data = 0;
+    reader->bits = 0;
+    portEXIT_CRITICAL_SAFE(&reader->lock);
+
+    if (!frame.bits || frame.bits > WIEGAND_SERVICE_MAX_BITS)
+        return;
+
+    svc->frames++;
+    if (!ring_push(svc, &frame))
+    {
+        svc->dropped++;
+        return;
+    }
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(svc->task, &woken);
+    if (woken == pdTRUE)
+        esp_timer_isr_dispatch_need_yield();
+#else
+    xTaskNotifyGive(svc->task);
+#endif
+}
+
+static void worker(void *arg)
+{
+    wiegand_service_t *svc = (wiegand_service_t *)arg;
+    wiegand_card_t cards[WIEGAND_SERVICE_BATCH];
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        size_t head;
+        while ((head = __atomic_load_n(&svc->head, __ATOMIC_ACQUIRE)) != svc->tail)
+        {
+            size_t tail = svc->tail;
+            size_t count = head - tail;
+            if (count > WIEGAND_SERVICE_BATCH)
+                count = WIEGAND_SERVICE_BATCH;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                esp_err_t res = wiegand_decode(&svc->ring[(tail + i) & (svc->ring_size - 1)], &cards[i]);
+                if (res != ESP_OK && res != ESP_ERR_NOT_SUPPORTED)
+                    ESP_LOGD(TAG, "Reader %d: %d bits, parity error", cards[i].frame.reader, cards[i].frame.bits);
+            }
+            __atomic_store_n(&svc->tail, tail + count, __ATOMIC_RELEASE);
+
+            svc->callback(cards, count, svc->ctx);
+        }
+    }
+}
+
+static inline uint64_t positions(uint8_t bits, uint8_t first, uint8_t last)
+{
+    // positions are 1-based, counted from the first received bit
+    uint8_t len = last - first + 1;
+    uint64_t mask = len >= 64 ? UINT64_MAX : (1ULL << len) - 1;
+    return mask << (bits - last);
+}
+
+static inline uint32_t field(const wiegand_frame_t *frame, uint8_t first, uint8_t last)
+{
+    return (frame->data & positions(frame->bits, first, last)) >> (frame->bits - last);
+}
+
+static inline bool parity_even(uint64_t data, uint64_t mask)
+{
+    return !(__builtin_popcountll(data & mask) & 1);
+}
+
+static inline bool parity_odd(uint64_t data, uint64_t mask)
+{
+    return __builtin_popcountll(data & mask) & 1;
+}
+
+// positions first..last except every third one, plus the parity bit itself
+static uint64_t hid_corp_mask(uint8_t first, uint8_t last, uint8_t skip, uint8_t parity)
+{
+    uint64_t mask = 1ULL << (35 - parity);
+    for (uint8_t p = first; p <= last; p++)
+        if (p % 3 != skip)
+            mask |= 1ULL << (35 - p);
+    return mask;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+esp_err_t wiegand_decode(const wiegand_frame_t *frame, wiegand_card_t *card)
+{
+    CHECK_ARG(frame && card && frame->bits && frame->bits <= WIEGAND_SERVICE_MAX_BITS);
+
+    memset(card, 0, sizeof(wiegand_card_t));
+    card->frame = *frame;
+
+    uint64_t d = frame->data;
+    uint8_t n = frame->bits;
+
+    switch (n)
+    {
+        case 26:
+            card->format = WIEGAND_FORMAT_26;
+            card->parity_ok = parity_even(d, positions(n, 1, 13)) && parity_odd(d, positions(n, 14, 26));
+            card->facility = field(frame, 2, 9);
+            card->card = field(frame, 10, 25);
+            break;
+        case 34:
+            card->format = WIEGAND_FORMAT_34;
+            card->parity_ok = parity_even(d, positions(n, 1, 17)) && parity_odd(d, positions(n, 18, 34));
+            card->facility = field(frame, 2, 17);
+            card->card = field(frame, 18, 33);
+            break;
+        case 35:
+            card->format = WIEGAND_FORMAT_35_HID_CORP;
+            card->parity_ok = parity_even(d, hid_corp_mask(2, 34, 2, 2))
+                    && parity_odd(d, hid_corp_mask(2, 35, 1, 35))
+                    && parity_odd(d, positions(n, 1, 35));
+            card->facility = field(frame, 3, 14);
+            card->card = field(frame, 15, 34);
+            break;
+        case 37:
+            card->format = WIEGAND_FORMAT_37;
+            card->parity_ok = parity_even(d, positions(n, 1, 19)) && parity_odd(d, positions(n, 19, 37));
+            card->facility = field(frame, 2, 17);
+            card->card = field(frame, 18, 36);
+            break;
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    return card->parity_ok ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t wiegand_service_init(wiegand_service_t *svc, size_t ring_size, wiegand_service_callback_t callback,
+        void *ctx, UBaseType_t priority)
+{
+    CHECK_ARG(svc && callback && ring_size && !(ring_size & (ring_size - 1)));
+
+    esp_err_t res = gpio_install_isr_service(0);
+    if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+        return res;
+
+    memset(svc, 0, sizeof(wiegand_service_t));
+    svc->ring_size = ring_size;
+    svc->callback = callback;
+    svc->ctx = ctx;
+
+    svc->ring = calloc(ring_size, sizeof(wiegand_frame_t));
+    if (!svc->ring)
+        return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate(worker, TAG, TASK_STACK_SIZE, svc, priority, &svc->task) != pdPASS)
+    {
+        free(svc->ring);
+        svc->ring = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t wiegand_service_done(wiegand_service_t *svc)
+{
+    CHECK_ARG(svc && svc->ring);
+
+    for (size_t i = 0; i < WIEGAND_SERVICE_MAX_READERS; i++)
+        if (svc->readers[i])
+            return ESP_ERR_INVALID_STATE;
+
+    vTaskDelete(svc->task);
+    svc->task = NULL;
+    free(svc->ring);
+    svc->ring = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t wiegand_service_add_reader(wiegand_service_t *svc, wiegand_service_reader_t *reader,
+        gpio_num_t gpio_d0, gpio_num_t gpio_d1, bool internal_pullups)
+{
+    CHECK_ARG(svc && svc->ring && reader);
+
+    uint8_t index = WIEGAND_SERVICE_MAX_READERS;
+    for (uint8_t i = 0; i < WIEGAND_SERVICE_MAX_READERS; i++)
+        if (!svc->readers[i])
+        {
+            index = i;
+            break;
+        }
+    if (index == WIEGAND_SERVICE_MAX_READERS)
+        return ESP_ERR_NO_MEM;
+
+    memset(reader, 0, sizeof(wiegand_service_reader_t));
+    reader->gpio_d0 = gpio_d0;
+    reader->gpio_d1 = gpio_d1;
+    reader->service = svc;
+    reader->index = index;
+    spinlock_initialize(&reader->lock);
+
+    esp_timer_create_args_t timer_args = {
+        .name = TAG,
+        .arg = reader,
+        .callback = timer_handler,
+        .dispatch_method = TIMER_DISPATCH
+    };
+    CHECK(esp_timer_create(&timer_args, &reader->timer));
+
+    esp_err_t res;
+    bool d0_added = false;
+    CHECK_GOTO(gpio_set_direction(gpio_d0, GPIO_MODE_INPUT));
+    CHECK_GOTO(gpio_set_direction(gpio_d1, GPIO_MODE_INPUT));
+    CHECK_GOTO(gpio_set_pull_mode(gpio_d0, internal_pullups ? GPIO_PULLUP_ONLY : GPIO_FLOATING));
+    CHECK_GOTO(gpio_set_pull_mode(gpio_d1, internal_pullups ? GPIO_PULLUP_ONLY : GPIO_FLOATING));
+    CHECK_GOTO(gpio_set_intr_type(gpio_d0, GPIO_INTR_NEGEDGE));
+    CHECK_GOTO(gpio_set_intr_type(gpio_d1, GPIO_INTR_NEGEDGE));
+    CHECK_GOTO(gpio_isr_handler_add(gpio_d0, isr_handler, reader));
+    d0_added = true;
+    CHECK_GOTO(gpio_isr_handler_add(gpio_d1, isr_handler, reader));
+
+    svc->readers[index] = reader;
+
+    ESP_LOGD(TAG, "Reader %d added on D0=%d, D1=%d", index, gpio_d0, gpio_d1);
+
+    return ESP_OK;
+
+fail:
+    gpio_set_intr_type(gpio_d0, GPIO_INTR_DISABLE);
+    gpio_set_intr_type(gpio_d1, GPIO_INTR_DISABLE);
+    // D0 edges may have started the timer already
+    if (d0_added)
+        gpio_isr_handler_remove(gpio_d0);
+    esp_timer_stop(reader->timer);
+    esp_timer_delete(reader->timer);
+    reader->timer = NULL;
+    reader->service = NULL;
+
+    return res;
+}
+
+esp_err_t wiegand_service_remove_reader(wiegand_service_reader_t *reader)
+{
+    CHECK_ARG(reader && reader->service);
+
+    gpio_set_intr_type(reader->gpio_d0, GPIO_INTR_DISABLE);
+    gpio_set_intr_type(reader->gpio_d1, GPIO_INTR_DISABLE);
+    CHECK(gpio_isr_handler_remove(reader->gpio_d0));
+    CHECK(gpio_isr_handler_remove(reader->gpio_d1));
+    esp_timer_stop(reader->timer);
+    CHECK(esp_timer_delete(reader->timer));
+
+    reader->service->readers[reader->index] = NULL;
+    reader->service = NULL;
+
+    ESP_LOGD(TAG, "Reader %d removed", reader->index);
+
+    return ESP_OK;
+}
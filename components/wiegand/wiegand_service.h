@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2021 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of itscontributors
+ *    may be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file wiegand_service.h
+ * @defgroup wiegand_service wiegand_service
+ * @{
+ *
+ * Multi-reader Wiegand receiver with batched frame decoding
+ *
+ * Bits are assembled in GPIO ISRs. Completed frames are handed off through
+ * a lock-free ring buffer to a single worker task, which checks parity,
+ * decodes known card formats and passes frames to the callback in batches.
+ *
+ * Copyright (c) 2021 Ruslan V. Uss <unclerus@gmail.com>
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __WIEGAND_SERVICE_H__
+#define __WIEGAND_SERVICE_H__
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/gpio.h>
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIEGAND_SERVICE_MAX_READERS 16 //!< Maximum number of readers per service
+#define WIEGAND_SERVICE_MAX_BITS    64 //!< Maximum frame length, bits
+#define WIEGAND_SERVICE_BATCH       16 //!< Maximum number of cards passed to callback at once
+
+/**
+ * Card formats
+ */
+typedef enum {
+    WIEGAND_FORMAT_UNKNOWN = 0, //!< Unknown format, only raw data is valid
+    WIEGAND_FORMAT_26,          //!< H10301, 26 bits: 8 bits facility, 16 bits card
+    WIEGAND_FORMAT_34,          //!< H10306, 34 bits: 16 bits facility, 16 bits card
+    WIEGAND_FORMAT_35_HID_CORP, //!< HID Corporate 1000, 35 bits: 12 bits company, 20 bits card
+    WIEGAND_FORMAT_37,          //!< H10304, 37 bits: 16 bits facility, 19 bits card
+} wiegand_format_t;
+
+/**
+ * Raw frame as received from reader
+ */
+typedef struct
+{
+    uint64_t data;      //!< Received bits, first received bit is the most significant
+    int64_t timestamp;  //!< Time of the last bit, us since boot
+    uint8_t bits;       //!< Number of received bits
+    uint8_t reader;     //!< Reader index
+} wiegand_frame_t;
+
+/**
+ * Decoded card
+ */
+typedef struct
+{
+    wiegand_frame_t frame;    //!< Raw frame
+    wiegand_format_t format;  //!< Detected format
+    bool parity_ok;           //!< Parity check result, false for unknown format
+    uint32_t facility;        //!< Facility code (company ID for HID Corporate 1000)
+    uint32_t card;            //!< Card number
+} wiegand_card_t;
+
+/**
+ * Callback for decoded cards, called from worker task
+ *
+ * @param cards Decoded cards
+ * @param count Number of cards
+ * @param ctx User context
+ */
+typedef void (*wiegand_service_callback_t)(const wiegand_card_t *cards, size_t count, void *ctx);
+
+typedef struct wiegand_service wiegand_service_t;
+
+/**
+ * Reader descriptor
+ */
+typedef struct
+{
+    gpio_num_t gpio_d0, gpio_d1;
+    wiegand_service_t *service;
+    uint8_t index;
+    esp_timer_handle_t timer;
+    portMUX_TYPE lock;
+    uint64_t data;
+    uint8_t bits;
+    int64_t last_bit;
+    uint32_t overflows;       //!< Number of frames longer than ::WIEGAND_SERVICE_MAX_BITS
+} wiegand_service_reader_t;
+
+/**
+ * Service descriptor
+ */
+struct wiegand_service
+{
+    wiegand_service_reader_t *readers[WIEGAND_SERVICE_MAX_READERS];
+    wiegand_frame_t *ring;
+    size_t ring_size;
+    volatile size_t head;
+    volatile size_t tail;
+    wiegand_service_callback_t callback;
+    void *ctx;
+    TaskHandle_t task;
+    volatile uint32_t frames;   //!< Number of frames received
+    volatile uint32_t dropped;  //!< Number of frames dropped because ring buffer was full
+};
+
+/**
+ * @brief Initialize service and start worker task
+ *
+ * @param svc Service descriptor
+ * @param ring_size Size of completed frames ring buffer, must be a power of 2
+ * @param callback Callback for decoded cards
+ * @param ctx User context passed to callback
+ * @param priority Worker task priority
+ * @return `ESP_OK` on success
+ */
+esp_err_t wiegand_service_init(wiegand_service_t *svc, size_t ring_size, wiegand_service_callback_t callback,
+        void *ctx, UBaseType_t priority);
+
+/**
+ * @brief Stop worker task and free resources
+ *
+ * All readers must be removed before calling this function.
+ *
+ * @param svc Service descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t wiegand_service_done(wiegand_service_t *svc);
+
+/**
+ * @brief Add reader to service
+ *
+ * @param svc Service descriptor
+ * @param reader Reader descriptor
+ * @param gpio_d0 GPIO pin for D0
+ * @param gpio_d1 GPIO pin for D1
+ * @param internal_pullups Enable internal pull-up resistors for D0 and D1 GPIO
+ * @return `ESP_OK` on success
+ */
+esp_err_t wiegand_service_add_reader(wiegand_service_t *svc, wiegand_service_reader_t *reader,
+        gpio_num_t gpio_d0, gpio_num_t gpio_d1, bool internal_pullups);
+
+/**
+ * @brief Remove reader from service
+ *
+ * @param reader Reader descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t wiegand_service_remove_reader(wiegand_service_reader_t *reader);
+
+/**
+ * @brief Check parity and decode frame
+ *
+ * @param frame Raw frame
+ * @param[out] card Decoded card
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_SUPPORTED` for unknown format,
+ *         `ESP_ERR_INVALID_CRC` on parity error
+ */
+esp_err_t wiegand_decode(const wiegand_frame_t *frame, wiegand_card_t *card);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __WIEGAND_SERVICE_H__ */
@@ -43,6 +43,9 @@ void led_task(void *pvParameter) {
 
   // Буфер для одного светодиода (3 байта: G, R, B)
   uint8_t led_data[3] = {0};
+  // Последние отправленные данные, передаем только изменения
+  uint8_t led_sent[3] = {0};
+  bool led_valid = false;
   TickType_t xLastWakeTime = xTaskGetTickCount();
   const TickType_t xFrequency = pdMS_TO_TICKS(20);
   while (1) {
@@ -53,10 +56,14 @@ void led_task(void *pvParameter) {
     led_data[1] = (rgb_led_values.red * rgb_led_values.brightness) / 255.0;
     led_data[2] = (rgb_led_values.blue * rgb_led_values.brightness) / 255.0;
 
-    // Отправляем данные на светодиод
-    ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_data,
-                                 sizeof(led_data), &tx_config));
-    ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+    // Отправляем данные на светодиод, только если цвет изменился
+    if (!led_valid || memcmp(led_data, led_sent, sizeof(led_data)) != 0) {
+      ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_data,
+                                   sizeof(led_data), &tx_config));
+      ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+      memcpy(led_sent, led_data, sizeof(led_data));
+      led_valid = true;
+    }
 
     // Задержка до следующего интервала
     vTaskDelayUntil(&xLastWakeTime, xFrequency);
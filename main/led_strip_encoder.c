@@ -1,62 +1,81 @@
 #include "main.h"
 static const char *TAG = "led_task";
 
+// Wire order of channels: offsets of the bytes in the input pixel
+static const struct {
+  uint8_t size;
+  uint8_t offset[4];
+} orders[LED_STRIP_ENCODER_ORDER_MAX] = {
+    [LED_STRIP_ENCODER_ORDER_RAW] = {1, {0}},
+    [LED_STRIP_ENCODER_ORDER_GRB] = {3, {1, 0, 2}},
+    [LED_STRIP_ENCODER_ORDER_RGB] = {3, {0, 1, 2}},
+    [LED_STRIP_ENCODER_ORDER_BRG] = {3, {2, 0, 1}},
+    [LED_STRIP_ENCODER_ORDER_GRBW] = {4, {1, 0, 2, 3}},
+    [LED_STRIP_ENCODER_ORDER_RGBW] = {4, {0, 1, 2, 3}},
+};
+
 typedef struct {
   rmt_encoder_t base;
-  rmt_encoder_t *bytes_encoder;
-  rmt_encoder_t *copy_encoder;
-  int state;
+  rmt_encoder_t *simple_encoder;
+  rmt_symbol_word_t bit0;
+  rmt_symbol_word_t bit1;
   rmt_symbol_word_t reset_code;
+  uint8_t pixel_size;
+  uint8_t offset[4];
 } rmt_led_strip_encoder_t;
 
+// Called by the simple encoder whenever there is free space in the RMT
+// memory (or DMA buffer), writes as many whole bytes as fit
+static size_t IRAM_ATTR rmt_encode_led_strip_cb(
+    const void *data, size_t data_size, size_t symbols_written,
+    size_t symbols_free, rmt_symbol_word_t *symbols, bool *done, void *arg) {
+  rmt_led_strip_encoder_t *led_encoder = (rmt_led_strip_encoder_t *)arg;
+  const uint8_t *pixels = (const uint8_t *)data;
+  // incomplete trailing pixel is ignored
+  data_size -= data_size % led_encoder->pixel_size;
+  size_t byte = symbols_written / 8;
+  size_t count = 0;
+
+  if (byte >= data_size) {
+    if (symbols_free < 1) {
+      return 0;
+    }
+    symbols[0] = led_encoder->reset_code;
+    *done = true;
+    return 1;
+  }
+
+  size_t pixel = byte / led_encoder->pixel_size;
+  size_t channel = byte % led_encoder->pixel_size;
+  for (; byte < data_size && count + 8 <= symbols_free; byte++) {
+    uint8_t b = pixels[pixel * led_encoder->pixel_size +
+                       led_encoder->offset[channel]];
+    for (uint8_t mask = 0x80; mask; mask >>= 1) {
+      symbols[count++] = b & mask ? led_encoder->bit1 : led_encoder->bit0;
+    }
+    if (++channel == led_encoder->pixel_size) {
+      channel = 0;
+      pixel++;
+    }
+  }
+  return count;
+}
+
 static size_t rmt_encode_led_strip(rmt_encoder_t *encoder,
                                    rmt_channel_handle_t channel,
                                    const void *primary_data, size_t data_size,
                                    rmt_encode_state_t *ret_state) {
   rmt_led_strip_encoder_t *led_encoder =
       __containerof(encoder, rmt_led_strip_encoder_t, base);
-  rmt_encoder_handle_t bytes_encoder = led_encoder->bytes_encoder;
-  rmt_encoder_handle_t copy_encoder = led_encoder->copy_encoder;
-  rmt_encode_state_t session_state = RMT_ENCODING_RESET;
-  rmt_encode_state_t state = RMT_ENCODING_RESET;
-  size_t encoded_symbols = 0;
-  switch (led_encoder->state) {
-  case 0: // send RGB data
-    encoded_symbols += bytes_encoder->encode(
-        bytes_encoder, channel, primary_data, data_size, &session_state);
-    if (session_state & RMT_ENCODING_COMPLETE) {
-      led_encoder->state =
-          1; // switch to next state when current encoding session finished
-    }
-    if (session_state & RMT_ENCODING_MEM_FULL) {
-      state |= RMT_ENCODING_MEM_FULL;
-      goto out; // yield if there's no free space for encoding artifacts
-    }
-  // fall-through
-  case 1: // send reset code
-    encoded_symbols +=
-        copy_encoder->encode(copy_encoder, channel, &led_encoder->reset_code,
-                             sizeof(led_encoder->reset_code), &session_state);
-    if (session_state & RMT_ENCODING_COMPLETE) {
-      led_encoder->state =
-          RMT_ENCODING_RESET; // back to the initial encoding session
-      state |= RMT_ENCODING_COMPLETE;
-    }
-    if (session_state & RMT_ENCODING_MEM_FULL) {
-      state |= RMT_ENCODING_MEM_FULL;
-      goto out; // yield if there's no free space for encoding artifacts
-    }
-  }
-out:
-  *ret_state = state;
-  return encoded_symbols;
+  rmt_encoder_handle_t simple_encoder = led_encoder->simple_encoder;
+  return simple_encoder->encode(simple_encoder, channel, primary_data,
+                                data_size, ret_state);
 }
 
 static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder) {
   rmt_led_strip_encoder_t *led_encoder =
       __containerof(encoder, rmt_led_strip_encoder_t, base);
-  rmt_del_encoder(led_encoder->bytes_encoder);
-  rmt_del_encoder(led_encoder->copy_encoder);
+  rmt_del_encoder(led_encoder->simple_encoder);
   free(led_encoder);
   return ESP_OK;
 }
@@ -64,68 +83,80 @@ static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder) {
 static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder) {
   rmt_led_strip_encoder_t *led_encoder =
       __containerof(encoder, rmt_led_strip_encoder_t, base);
-  rmt_encoder_reset(led_encoder->bytes_encoder);
-  rmt_encoder_reset(led_encoder->copy_encoder);
-  led_encoder->state = RMT_ENCODING_RESET;
-  return ESP_OK;
+  return rmt_encoder_reset(led_encoder->simple_encoder);
+}
+
+static inline uint32_t ns_to_ticks(uint32_t resolution, uint32_t ns) {
+  return ((uint64_t)resolution * ns + 500000000) / 1000000000;
 }
 
 esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config,
                                     rmt_encoder_handle_t *ret_encoder) {
   esp_err_t ret = ESP_OK;
   rmt_led_strip_encoder_t *led_encoder = NULL;
-  ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG,
-                    "invalid argument");
+  ESP_GOTO_ON_FALSE(config && ret_encoder &&
+                        config->order < LED_STRIP_ENCODER_ORDER_MAX,
+                    ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+  // callback may run in ISR context, keep its state in internal memory
   led_encoder = rmt_alloc_encoder_mem(sizeof(rmt_led_strip_encoder_t));
   ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG,
                     "no mem for led strip encoder");
+  memset(led_encoder, 0, sizeof(rmt_led_strip_encoder_t));
   led_encoder->base.encode = rmt_encode_led_strip;
   led_encoder->base.del = rmt_del_led_strip_encoder;
   led_encoder->base.reset = rmt_led_strip_encoder_reset;
-  // different led strip might have its own timing requirements, following
-  // parameter is for WS2812
-  rmt_bytes_encoder_config_t bytes_encoder_config = {
-      .bit0 =
-          {
-              .level0 = 1,
-              .duration0 = 0.3 * config->resolution / 1000000, // T0H=0.3us
-              .level1 = 0,
-              .duration1 = 0.9 * config->resolution / 1000000, // T0L=0.9us
-          },
-      .bit1 =
-          {
-              .level0 = 1,
-              .duration0 = 0.9 * config->resolution / 1000000, // T1H=0.9us
-              .level1 = 0,
-              .duration1 = 0.3 * config->resolution / 1000000, // T1L=0.3us
-          },
-      .flags.msb_first = 1 // WS2812 transfer bit order: G7...G0R7...R0B7...B0
+
+  led_strip_encoder_timing_t timing = config->timing;
+  led_strip_encoder_timing_t ws2812 = LED_STRIP_ENCODER_TIMING_WS2812;
+  if (!timing.t0h_ns || !timing.t0l_ns || !timing.t1h_ns || !timing.t1l_ns) {
+    timing = ws2812;
+  }
+  if (!timing.reset_us) {
+    timing.reset_us = ws2812.reset_us;
+  }
+  led_encoder->bit0 = (rmt_symbol_word_t){
+      .level0 = 1,
+      .duration0 = ns_to_ticks(config->resolution, timing.t0h_ns),
+      .level1 = 0,
+      .duration1 = ns_to_ticks(config->resolution, timing.t0l_ns),
+  };
+  led_encoder->bit1 = (rmt_symbol_word_t){
+      .level0 = 1,
+      .duration0 = ns_to_ticks(config->resolution, timing.t1h_ns),
+      .level1 = 0,
+      .duration1 = ns_to_ticks(config->resolution, timing.t1l_ns),
   };
-  ESP_GOTO_ON_ERROR(
-      rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder),
-      err, TAG, "create bytes encoder failed");
-  rmt_copy_encoder_config_t copy_encoder_config = {};
-  ESP_GOTO_ON_ERROR(
-      rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder),
-      err, TAG, "create copy encoder failed");
-
-  uint32_t reset_ticks = config->resolution / 1000000 * 50 /
-                         2; // reset code duration defaults to 50us
+  uint32_t reset_ticks =
+      ns_to_ticks(config->resolution, timing.reset_us * 1000) / 2;
+  ESP_GOTO_ON_FALSE(led_encoder->bit0.duration0 && led_encoder->bit1.duration1 &&
+                        reset_ticks && reset_ticks < 0x8000,
+                    ESP_ERR_INVALID_ARG, err, TAG,
+                    "timing does not fit resolution");
   led_encoder->reset_code = (rmt_symbol_word_t){
       .level0 = 0,
       .duration0 = reset_ticks,
       .level1 = 0,
       .duration1 = reset_ticks,
   };
+  led_encoder->pixel_size = orders[config->order].size;
+  memcpy(led_encoder->offset, orders[config->order].offset,
+         sizeof(led_encoder->offset));
+
+  rmt_simple_encoder_config_t simple_encoder_config = {
+      .callback = rmt_encode_led_strip_cb,
+      .arg = led_encoder,
+      .min_chunk_size = 64, // 8 bytes, must not be less than 8 symbols
+  };
+  ESP_GOTO_ON_ERROR(rmt_new_simple_encoder(&simple_encoder_config,
+                                           &led_encoder->simple_encoder),
+                    err, TAG, "create simple encoder failed");
+
   *ret_encoder = &led_encoder->base;
   return ESP_OK;
 err:
   if (led_encoder) {
-    if (led_encoder->bytes_encoder) {
-      rmt_del_encoder(led_encoder->bytes_encoder);
-    }
-    if (led_encoder->copy_encoder) {
-      rmt_del_encoder(led_encoder->copy_encoder);
+    if (led_encoder->simple_encoder) {
+      rmt_del_encoder(led_encoder->simple_encoder);
     }
     free(led_encoder);
   }
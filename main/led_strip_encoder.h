@@ -12,16 +12,57 @@
 extern "C" {
 #endif
 
+/**
+ * @brief LED bit timing, zero fields are taken from WS2812 timing
+ */
+typedef struct {
+  uint16_t t0h_ns;   /*!< High time of bit 0, in ns */
+  uint16_t t0l_ns;   /*!< Low time of bit 0, in ns */
+  uint16_t t1h_ns;   /*!< High time of bit 1, in ns */
+  uint16_t t1l_ns;   /*!< Low time of bit 1, in ns */
+  uint32_t reset_us; /*!< Reset (latch) time after the frame, in us */
+} led_strip_encoder_timing_t;
+
+#define LED_STRIP_ENCODER_TIMING_WS2812                                        \
+  ((led_strip_encoder_timing_t){300, 900, 900, 300, 50})
+#define LED_STRIP_ENCODER_TIMING_SK6812                                        \
+  ((led_strip_encoder_timing_t){300, 900, 600, 600, 80})
+#define LED_STRIP_ENCODER_TIMING_WS2811                                        \
+  ((led_strip_encoder_timing_t){500, 2000, 1200, 1300, 50}) // 400 kHz mode
+
+/**
+ * @brief Order of color channels on the wire
+ *
+ * Pixels are given as R, G, B (R, G, B, W for RGBW orders), e.g. `rgb_t`
+ * of framebuffer, and reordered while encoding.
+ */
+typedef enum {
+  LED_STRIP_ENCODER_ORDER_RAW = 0, /*!< Bytes are sent as is */
+  LED_STRIP_ENCODER_ORDER_GRB,     /*!< WS2812 */
+  LED_STRIP_ENCODER_ORDER_RGB,     /*!< WS2811 */
+  LED_STRIP_ENCODER_ORDER_BRG,
+  LED_STRIP_ENCODER_ORDER_GRBW, /*!< SK6812 RGBW */
+  LED_STRIP_ENCODER_ORDER_RGBW,
+  LED_STRIP_ENCODER_ORDER_MAX,
+} led_strip_encoder_order_t;
+
 /**
  * @brief Type of led strip encoder configuration
  */
 typedef struct {
-    uint32_t resolution; /*!< Encoder resolution, in Hz */
+  uint32_t resolution; /*!< Encoder resolution, in Hz */
+  led_strip_encoder_timing_t timing; /*!< Bit timing */
+  led_strip_encoder_order_t order;   /*!< Color order */
 } led_strip_encoder_config_t;
 
 /**
  * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols
  *
+ * Symbols are generated directly from the pixel data into the RMT memory
+ * in chunks, so strips of any length may be sent without intermediate
+ * buffers. For thousands of LEDs create the channel with `flags.with_dma`
+ * and a large `mem_block_symbols` to avoid refill interrupts.
+ *
  * @param[in] config Encoder configuration
  * @param[out] ret_encoder Returned encoder handle
  * @return
@@ -29,8 +70,9 @@ typedef struct {
  *      - ESP_ERR_NO_MEM out of memory when creating led strip encoder
  *      - ESP_OK if creating encoder successfully
  */
-esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config,
+                                    rmt_encoder_handle_t *ret_encoder);
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif